@@ -0,0 +1,250 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Simple zone file system for zoned block devices.
+ *
+ * Copyright (C) 2019 Western Digital Corporation or its affiliates.
+ *
+ * Added POSIX features to original zonefs.
+ *
+ * Copyright (C) 2025 StayInTheKitchen, Antler9000
+ */
+
+#include <linux/fs.h>
+#include <linux/bitops.h>
+#include <linux/debugfs.h>
+#include <linux/percpu.h>
+#include <linux/seq_file.h>
+
+#include "zonefs.h"
+#include "hodo.h"
+#include "trans.h"
+
+DEFINE_PER_CPU(struct hodo_latency, hodo_latency);
+
+static const char * const hodo_lat_names[HODO_LAT_NR] = {
+	[HODO_LAT_CREATE]	= "create",
+	[HODO_LAT_UNLINK]	= "unlink",
+	[HODO_LAT_MKDIR]	= "mkdir",
+	[HODO_LAT_LOOKUP]	= "lookup",
+	[HODO_LAT_READDIR]	= "readdir",
+	[HODO_LAT_READ_ITER]	= "read_iter",
+	[HODO_LAT_WRITE_ITER]	= "write_iter",
+	[HODO_LAT_DEVICE_READ]	= "device_read",
+	[HODO_LAT_DEVICE_WRITE]	= "device_write",
+	[HODO_LAT_GC]		= "gc",
+};
+
+static struct dentry *hodo_debugfs_root;
+
+/* Range of mapping_table indexes dumped by hodo_mapping */
+static u32 hodo_mapping_start;
+static u32 hodo_mapping_count = NUMBER_MAPPING_TABLE_ENTRY;
+
+/* Number of characters in one zone's utilization map */
+#define HODO_HEATMAP_WIDTH	64
+
+/*
+ * One section per operation: the total number of calls, then one line per
+ * non-empty bucket with its [low, high) range in nanoseconds.
+ */
+static int hodo_latency_show(struct seq_file *m, void *v)
+{
+	u64 count[HODO_LAT_BUCKETS];
+	u64 total;
+	int item, i, cpu;
+
+	for (item = 0; item < HODO_LAT_NR; item++) {
+		total = 0;
+		for (i = 0; i < HODO_LAT_BUCKETS; i++) {
+			count[i] = 0;
+			for_each_possible_cpu(cpu)
+				count[i] += per_cpu(hodo_latency, cpu).bucket[item][i];
+			total += count[i];
+		}
+
+		seq_printf(m, "%s: %llu\n", hodo_lat_names[item], total);
+		for (i = 0; i < HODO_LAT_BUCKETS; i++) {
+			if (!count[i])
+				continue;
+			if (i == HODO_LAT_BUCKETS - 1)
+				seq_printf(m, "  [%llu, inf) ns: %llu\n",
+					   1ULL << i, count[i]);
+			else
+				seq_printf(m, "  [%llu, %llu) ns: %llu\n",
+					   i ? 1ULL << i : 0, 1ULL << (i + 1),
+					   count[i]);
+		}
+	}
+
+	return 0;
+}
+
+static int hodo_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, hodo_latency_show, inode->i_private);
+}
+
+/* Any write clears every histogram */
+static ssize_t hodo_latency_write(struct file *file, const char __user *buf,
+				  size_t count, loff_t *ppos)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		memset(per_cpu_ptr(&hodo_latency, cpu), 0,
+		       sizeof(struct hodo_latency));
+
+	return count;
+}
+
+static const struct file_operations hodo_latency_fops = {
+	.owner		= THIS_MODULE,
+	.open		= hodo_latency_open,
+	.read		= seq_read,
+	.write		= hodo_latency_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+/*
+ * Mapped entries of mapping_table, one "lbn zone:block" line each. Only the
+ * [hodo_mapping_start, hodo_mapping_start + hodo_mapping_count) index range
+ * is walked. Entries are read without locking, so a dump taken while the
+ * file system is busy may mix old and new positions.
+ */
+static u32 hodo_mapping_end(void)
+{
+	u64 end = (u64)hodo_mapping_start + hodo_mapping_count;
+
+	return min_t(u64, end, NUMBER_MAPPING_TABLE_ENTRY);
+}
+
+static void *hodo_mapping_find(loff_t *pos)
+{
+	u32 end = hodo_mapping_end();
+	u64 index = (u64)hodo_mapping_start + *pos;
+
+	while (index < end) {
+		if (mapping_info.mapping_table[index].zone_id)
+			break;
+		index++;
+	}
+	if (index >= end)
+		return NULL;
+
+	*pos = index - hodo_mapping_start;
+	return &mapping_info.mapping_table[index];
+}
+
+static void *hodo_mapping_seq_start(struct seq_file *m, loff_t *pos)
+{
+	return hodo_mapping_find(pos);
+}
+
+static void *hodo_mapping_seq_next(struct seq_file *m, void *v, loff_t *pos)
+{
+	(*pos)++;
+	return hodo_mapping_find(pos);
+}
+
+static void hodo_mapping_seq_stop(struct seq_file *m, void *v)
+{
+}
+
+static int hodo_mapping_seq_show(struct seq_file *m, void *v)
+{
+	struct hodo_block_pos *entry = v;
+	struct hodo_block_pos block_pos = *entry;
+	u32 index = entry - mapping_info.mapping_table;
+
+	seq_printf(m, "%u %u:%u\n",
+		   index + mapping_info.starting_logical_number,
+		   block_pos.zone_id, block_pos.block_index);
+
+	return 0;
+}
+
+static const struct seq_operations hodo_mapping_seq_ops = {
+	.start	= hodo_mapping_seq_start,
+	.next	= hodo_mapping_seq_next,
+	.stop	= hodo_mapping_seq_stop,
+	.show	= hodo_mapping_seq_show,
+};
+DEFINE_SEQ_ATTRIBUTE(hodo_mapping);
+
+/*
+ * One line per data zone: valid and invalid block counts, then a map of
+ * HODO_HEATMAP_WIDTH characters where each character shows the share of
+ * valid blocks in its slice of the zone (' ' none, '.', ':', '+', '#' all).
+ * The zone holding the write pointer is marked with '*'.
+ */
+static int hodo_zones_show(struct seq_file *m, void *v)
+{
+	static const char levels[] = " .:+#";
+	u32 words = BLOCKS_PER_ZONE / 32 / HODO_HEATMAP_WIDTH;
+	int zone_id, i, j;
+
+	for (zone_id = 1; zone_id < min(hodo_nr_zones, NUMBER_ZONES); zone_id++) {
+		seq_printf(m, "%2d%c valid=%6u invalid=%6u |", zone_id,
+			   zone_id == mapping_info.wp.zone_id ? '*' : ' ',
+			   hodo_get_zone_valid_count(zone_id),
+			   hodo_get_zone_invalid_count(zone_id));
+
+		for (i = 0; i < HODO_HEATMAP_WIDTH; i++) {
+			u32 valid = 0;
+
+			for (j = 0; j < words; j++)
+				valid += hweight32(mapping_info.GC_bitmap[zone_id][i * words + j]);
+
+			if (!valid)
+				seq_putc(m, levels[0]);
+			else
+				seq_putc(m, levels[1 + (valid * 4 - 1) / (words * 32)]);
+		}
+		seq_puts(m, "|\n");
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(hodo_zones);
+
+static int hodo_wp_show(struct seq_file *m, void *v)
+{
+	seq_printf(m, "wp: %u:%u\n", mapping_info.wp.zone_id,
+		   mapping_info.wp.block_index);
+	seq_printf(m, "swap_wp: %u:%u\n", mapping_info.swap_wp.zone_id,
+		   mapping_info.swap_wp.block_index);
+	seq_printf(m, "free_zones: %u\n", hodo_get_free_zone_count());
+	seq_printf(m, "gc_victim: %d\n", hodo_get_GC_victim());
+	seq_printf(m, "valid_blocks: %u\n", mapping_info.valid_count);
+	seq_printf(m, "invalid_blocks: %u\n", mapping_info.invalid_count);
+	seq_printf(m, "free_logical_numbers: %u\n",
+		   hodo_get_free_logical_count());
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(hodo_wp);
+
+void hodo_debugfs_init(void)
+{
+	hodo_debugfs_root = debugfs_create_dir("zonefs", NULL);
+
+	debugfs_create_file("hodo_latency", 0600, hodo_debugfs_root, NULL,
+			    &hodo_latency_fops);
+	debugfs_create_file("hodo_mapping", 0400, hodo_debugfs_root, NULL,
+			    &hodo_mapping_fops);
+	debugfs_create_u32("hodo_mapping_start", 0600, hodo_debugfs_root,
+			   &hodo_mapping_start);
+	debugfs_create_u32("hodo_mapping_count", 0600, hodo_debugfs_root,
+			   &hodo_mapping_count);
+	debugfs_create_file("hodo_zones", 0400, hodo_debugfs_root, NULL,
+			    &hodo_zones_fops);
+	debugfs_create_file("hodo_wp", 0400, hodo_debugfs_root, NULL,
+			    &hodo_wp_fops);
+}
+
+void hodo_debugfs_exit(void)
+{
+	debugfs_remove_recursive(hodo_debugfs_root);
+	hodo_debugfs_root = NULL;
+}
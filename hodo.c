@@ -10,8 +10,16 @@
  */
 
 #include <linux/blkdev.h>
+#include <linux/falloc.h>
+#include <linux/iomap.h>
+#include <linux/ktime.h>
+#include <linux/mempool.h>
+#include <linux/pagemap.h>
+#include <linux/percpu.h>
 #include <linux/quotaops.h>
+#include <linux/splice.h>
 #include <linux/string.h>
+#include <linux/uio.h>
 
 #include "zonefs.h"
 #include "hodo.h"
@@ -20,6 +28,11 @@
 static ssize_t hodo_file_read_iter(struct kiocb *iocb, struct iov_iter *to);
 static ssize_t hodo_file_write_iter(struct kiocb *iocb, struct iov_iter *from);
 static int hodo_readdir(struct file *file, struct dir_context *ctx);
+static long hodo_file_fallocate(struct file *file, int mode, loff_t offset, loff_t len);
+static loff_t hodo_file_remap_range(struct file *file_in, loff_t pos_in, struct file *file_out, loff_t pos_out,
+                                    loff_t len, unsigned int remap_flags);
+static ssize_t hodo_file_copy_range(struct file *file_in, loff_t pos_in, struct file *file_out, loff_t pos_out,
+                                    size_t len, unsigned int flags);
 
 /*----------------------------------------------------------아이노드 오퍼레이션 함수 선언-------------------------------------------------------------------------------*/
 static int hodo_setattr(struct mnt_idmap *idmap, struct dentry *dentry, struct iattr *iattr);
@@ -28,6 +41,13 @@ static int hodo_create(struct mnt_idmap *idmap, struct inode *dir,struct dentry
 static int hodo_unlink(struct inode *dir, struct dentry *dentry);
 static int hodo_mkdir(struct mnt_idmap *idmap, struct inode *dir, struct dentry *dentry, umode_t mode);
 static int hodo_rmdir(struct inode *dir, struct dentry *dentry);
+static int hodo_rename(struct mnt_idmap *idmap, struct inode *old_dir, struct dentry *old_dentry,
+                       struct inode *new_dir, struct dentry *new_dentry, unsigned int flags);
+static int hodo_fiemap(struct inode *inode, struct fiemap_extent_info *fieinfo, u64 start, u64 len);
+static const struct iomap_ops hodo_read_iomap_ops;
+static int hodo_link(struct dentry *old_dentry, struct inode *dir, struct dentry *dentry);
+static int hodo_symlink(struct mnt_idmap *idmap, struct inode *dir, struct dentry *dentry, const char *symname);
+static const char *hodo_get_link(struct dentry *dentry, struct inode *inode, struct delayed_call *done);
 
 /*----------------------------------------------------------주소공간 오퍼레이션 함수 선언-------------------------------------------------------------------------------*/
 //nothing
@@ -36,11 +56,67 @@ static int hodo_rmdir(struct inode *dir, struct dentry *dentry);
 static struct dentry *hodo_sub_lookup(struct inode* dir, struct dentry* dentry, unsigned int flags);
 static int hodo_sub_readdir(struct file *file, struct dir_context *ctx);
 static int hodo_sub_setattr(struct mnt_idmap *idmap, struct dentry *dentry, struct iattr *iattr);
+static ssize_t hodo_sub_file_read_iter(struct kiocb *iocb, struct iov_iter *to);
 static ssize_t hodo_sub_file_write_iter(struct kiocb *iocb, struct iov_iter *from);
+static ssize_t hodo_sub_file_dio_read(struct kiocb *iocb, struct iov_iter *to);
+static loff_t hodo_sub_file_llseek(struct file *filp, loff_t offset, int whence);
+static void hodo_invalidate_written_range(struct kiocb *iocb, ssize_t written_size);
+static bool hodo_dio_aligned(struct kiocb *iocb, struct iov_iter *iter);
+static void hodo_sub_drop_link(struct inode *inode, struct timespec64 now);
+static void hodo_sub_drop_dir_nlink(struct inode *dir);
+static void hodo_sub_write_nlink(struct inode *inode);
+static void hodo_sub_write_name(struct inode *inode, const struct qstr *name, struct timespec64 now);
+static void hodo_sub_replace_dirent(struct inode *dir, const char *name, struct hodo_inode *sub_inode);
+static void hodo_sub_remove_dirent(struct inode *dir, const char *name);
 
 /*----------------------------------------------------------글로벌 변수 및 초기화--------------------------------------------------------------------------------------*/
 struct hodo_mapping_info mapping_info;
 char mount_point_path[16];
+DEFINE_PER_CPU(struct hodo_stats, hodo_stats);
+
+//블록 하나(4KB) 크기의 임시 버퍼들. 아이노드, extent leaf, dirent 블록 등을 읽고 고쳐 쓸 때 모두 여기서 받는다.
+//slab에서 받되, 메모리가 부족해도 쓰기와 GC가 멈추지 않도록 CPU마다 HODO_BLOCK_POOL_RESERVE개를 mempool로 잡아 둔다.
+static struct kmem_cache *hodo_block_cachep;
+static mempool_t *hodo_block_pool;
+
+u64 hodo_stat_read(enum hodo_stat_item item) {
+    u64 sum = 0;
+    int cpu;
+
+    for_each_possible_cpu(cpu)
+        sum += per_cpu(hodo_stats, cpu).count[item];
+
+    return sum;
+}
+
+int hodo_block_pool_init(void) {
+    //O_DIRECT로 zone 파일을 읽고 쓰는 버퍼이므로 블록 크기로 정렬한다
+    hodo_block_cachep = kmem_cache_create("hodo_block", HODO_DATABLOCK_SIZE, HODO_DATABLOCK_SIZE, 0, NULL);
+    if (!hodo_block_cachep)
+        return -ENOMEM;
+
+    hodo_block_pool = mempool_create_slab_pool(HODO_BLOCK_POOL_RESERVE * num_possible_cpus(), hodo_block_cachep);
+    if (!hodo_block_pool) {
+        kmem_cache_destroy(hodo_block_cachep);
+        return -ENOMEM;
+    }
+
+    return 0;
+}
+
+void hodo_block_pool_exit(void) {
+    mempool_destroy(hodo_block_pool);
+    kmem_cache_destroy(hodo_block_cachep);
+}
+
+//GFP_NOFS로 받으므로 실패하지 않고, 메모리가 부족하면 다른 버퍼가 돌아올 때까지 기다린다
+void *hodo_alloc_block(void) {
+    return mempool_alloc(hodo_block_pool, GFP_NOFS);
+}
+
+void hodo_free_block(void *block) {
+    mempool_free(block, hodo_block_pool);
+}
 
 void hodo_init(void) {
     // ZONEFS_TRACE();
@@ -99,6 +175,9 @@ void hodo_init(void) {
 
     mapping_info.starting_logical_number = hodo_nr_zones;
     hodo_read_on_disk_mapping_info();
+    hodo_init_logical_allocator();
+    hodo_rebuild_zone_stats();
+    hodo_extent_cache_reset();
     /*TO DO: crash check & recovery*/
 
     // if it's first mount after formatting
@@ -116,32 +195,36 @@ void hodo_init(void) {
         
 
         // root direcotry inode 설정
-        struct hodo_inode root_inode;
+        struct hodo_inode *root_inode = hodo_alloc_block();
+        memset(root_inode, 0, sizeof(struct hodo_inode));
 
         // 여기부터 hinode 초기화: 함수로 리팩터링
-        root_inode.magic[0] = 'I';
-        root_inode.magic[1] = 'N';
-        root_inode.magic[2] = 'O';
-        root_inode.magic[3] = 'D';
+        root_inode->magic[0] = 'I';
+        root_inode->magic[1] = 'N';
+        root_inode->magic[2] = 'O';
+        root_inode->magic[3] = 'D';
+
+        root_inode->file_len = 0;
 
-        root_inode.file_len = 0;
+        root_inode->name_len = 1;
+        memcpy(root_inode->name, "/", root_inode->name_len);
 
-        root_inode.name_len = 1;
-        memcpy(root_inode.name, "/", root_inode.name_len);
+        root_inode->type = 1;
 
-        root_inode.type = 1;
+        root_inode->i_ino = hodo_get_next_logical_number();
+        root_inode->i_mode = S_IFDIR; 
 
-        root_inode.i_ino = hodo_get_next_logical_number();
-        root_inode.i_mode = S_IFDIR; 
+        root_inode->i_uid = current_fsuid();
+        root_inode->i_gid = current_fsgid();
 
-        root_inode.i_uid = current_fsuid();
-        root_inode.i_gid = current_fsgid();
+        root_inode->i_nlink = 2;
 
-        root_inode.i_nlink = 1;
+        // 새 디렉토리는 dirent들을 아이노드 안에 보관하다가, 넘치면 데이터블록으로 옮긴다
+        root_inode->i_flags = HODO_INODE_INLINE_DIRENT;
 
         // root inode를 wp에 쓰기
-        logical_block_number_t root_inode_logical_number = root_inode.i_ino;
-        hodo_write_struct(&root_inode, sizeof(root_inode), &root_inode_logical_number);
+        hodo_write_inode(root_inode);
+        hodo_free_block(root_inode);
     }
 }
 
@@ -156,6 +239,8 @@ static int hodo_file_open(struct inode *inode, struct file *filp) {
         return zonefs_file_operations.open(inode, filp);
     }
 
+    filp->f_mode |= FMODE_CAN_ODIRECT;
+
     return 0;
 }
 
@@ -178,16 +263,35 @@ static int hodo_file_release(struct inode *inode, struct file *filp) {
     return 0;
 }
 
+//hodo 파일의 데이터는 write_iter가 이미 zone에 직접 썼고, 크기와 extent도 쓰기마다 hodo 아이노드에 기록된다.
+//fsync는 mmap으로 더럽혀진 페이지와 이 아이노드의 속성만 쓰고, 모여 있는 메타데이터를 커밋한 뒤 장치 캐시를 한 번 비운다.
 static int hodo_file_fsync(struct file *filp, loff_t start, loff_t end, int datasync) {
     // ZONEFS_TRACE();
 
-    int file_ino = filp->f_inode->i_ino;
+    struct inode *inode = file_inode(filp);
+    int ret;
 
-    if (file_ino < mapping_info.starting_logical_number) {
+    if (inode->i_ino < mapping_info.starting_logical_number) {
         return zonefs_file_operations.fsync(filp, start, end, datasync);
     }
 
-    return 0;
+    ret = file_write_and_wait_range(filp, start, end);
+    if (ret)
+        return ret;
+
+    //fdatasync는 시각만 바뀐 아이노드를 쓰지 않는다. 데이터를 다시 찾는 데는 필요 없기 때문이다.
+    if ((inode->i_state & I_DIRTY_ALL) &&
+        (!datasync || (inode->i_state & I_DIRTY_DATASYNC))) {
+        ret = sync_inode_metadata(inode, 1);
+        if (ret)
+            return ret;
+    }
+
+    ret = hodo_trans_commit();
+    if (ret)
+        return ret;
+
+    return blkdev_issue_flush(inode->i_sb->s_bdev);
 }
 
 static int hodo_file_mmap(struct file *filp, struct vm_area_struct *vma) {
@@ -198,6 +302,10 @@ static int hodo_file_mmap(struct file *filp, struct vm_area_struct *vma) {
 static loff_t hodo_file_llseek(struct file *filp, loff_t offset, int whence) {
     // ZONEFS_TRACE();
 
+    //hodo 파일의 SEEK_DATA, SEEK_HOLE은 extent tree를 보고 구멍을 건너뛴다
+    if (filp->f_inode->i_ino >= mapping_info.starting_logical_number && (whence == SEEK_DATA || whence == SEEK_HOLE))
+        return hodo_sub_file_llseek(filp, offset, whence);
+
     return zonefs_file_operations.llseek(filp, offset, whence);
 }
 
@@ -217,66 +325,12 @@ static ssize_t hodo_file_read_iter(struct kiocb *iocb, struct iov_iter *to) {
 	    return zonefs_file_operations.read_iter(iocb, to);
     }
 
-    logical_block_number_t file_inode_logical_number = file_ino;
-    struct hodo_inode file_inode = {0,};
-
-    hodo_read_struct(file_inode_logical_number, &file_inode, sizeof(struct hodo_inode));
-
-    // pr_info("ki_pos: %d\n", iocb->ki_pos);
-    // pr_info("iov_iter count: %d\n", iov_iter_count(to));
-
-    // 읽을 길이 min(파일 끝 - 요청 시작 길이, 요청 길이)
-    int read_len = (file_inode.file_len - iocb->ki_pos); 
-    if (iov_iter_count(to) < read_len) {
-        read_len = iov_iter_count(to);
-    }
-
-    // EOF
-    if (iocb->ki_pos >= file_inode.file_len) {
-        return 0;
-    }
-    
-    int start_block = (iocb->ki_pos) / HODO_DATA_SIZE; 
-    int end_block = (iocb->ki_pos + read_len) / HODO_DATA_SIZE;
-
-    struct hodo_datablock* temp_datablock = kmalloc(HODO_DATABLOCK_SIZE, GFP_KERNEL);
-
-    int cur_block = start_block;
-
-    int offset_in_start_block = (iocb->ki_pos % HODO_DATA_SIZE);
-    int bytes_in_start_block = HODO_DATA_SIZE - offset_in_start_block;
-    int bytes_in_end_block = (iocb->ki_pos + read_len) % HODO_DATA_SIZE; 
-
-    if (start_block != end_block) {
-        hodo_read_nth_block(&file_inode, cur_block, temp_datablock);
-        copy_to_iter((char*)temp_datablock + HODO_DATA_START + offset_in_start_block, bytes_in_start_block, to);
-        iocb->ki_pos += bytes_in_start_block;
-        cur_block++;
-    }
-    else {
-        hodo_read_nth_block(&file_inode, cur_block, temp_datablock);
-        copy_to_iter((char*)temp_datablock + HODO_DATA_START + offset_in_start_block, read_len, to);
-        iocb->ki_pos += read_len;
-        return read_len;
-    }
-
+    //그 외는 우리가 정의한 hodo sub read iter를 호출
+    uint64_t start_ns = ktime_get_ns();
+    ssize_t ret = hodo_sub_file_read_iter(iocb, to);
 
-    while (cur_block < end_block) {
-        hodo_read_nth_block(&file_inode, cur_block, temp_datablock);
-        copy_to_iter((char*)temp_datablock + HODO_DATA_START, HODO_DATA_SIZE, to);
-        iocb->ki_pos += HODO_DATA_SIZE;
-        cur_block++;
-    }
-
-    if (cur_block == end_block) {
-        hodo_read_nth_block(&file_inode, cur_block, temp_datablock);
-        copy_to_iter((char*)temp_datablock + HODO_DATA_START, bytes_in_end_block, to);
-        iocb->ki_pos += bytes_in_end_block;
-    }
-
-    kfree(temp_datablock);
-
-	return read_len;
+    hodo_latency_record(HODO_LAT_READ_ITER, start_ns);
+    return ret;
 }
 
 static ssize_t hodo_file_write_iter(struct kiocb *iocb, struct iov_iter *from) {
@@ -292,7 +346,32 @@ static ssize_t hodo_file_write_iter(struct kiocb *iocb, struct iov_iter *from) {
 
     //그 외는 우리가 정의한 hodo sub write iter를 호출
     // pr_info("zonefs: using custom write_iter for target (ino :'%d')\n", target_ino);
-    return hodo_sub_file_write_iter(iocb, from);
+    uint64_t start_ns = ktime_get_ns();
+
+    //fallocate, truncate, reflink와 같은 파일의 쓰기들이 서로 섞이지 않도록 inode lock을 잡는다. 장치 캐시를 비우는 동안에는 놓는다.
+    struct inode *inode = file_inode(iocb->ki_filp);
+
+    if (iocb->ki_flags & IOCB_NOWAIT) {
+        if (!inode_trylock(inode))
+            return -EAGAIN;
+    }
+    else {
+        inode_lock(inode);
+    }
+
+    //mtime, ctime은 쓰기 경로가 아이노드를 새로 쓸 때 함께 실린다. lazytime으로 마운트했다면 그 전까지는 메모리에만 있다.
+    ssize_t ret = file_update_time(iocb->ki_filp);
+    if (!ret)
+        ret = hodo_sub_file_write_iter(iocb, from);
+
+    inode_unlock(inode);
+
+    //O_SYNC, O_DSYNC 쓰기는 fsync와 같은 길로 장치 캐시를 비운다
+    if (ret > 0)
+        ret = generic_write_sync(iocb, ret);
+
+    hodo_latency_record(HODO_LAT_WRITE_ITER, start_ns);
+    return ret;
 }
 
 static ssize_t hodo_file_splice_read(struct file *in, loff_t *ppos,
@@ -312,6 +391,205 @@ static int hodo_file_iocb_bio_iopoll(struct kiocb *iocb, struct io_comp_batch *i
     return zonefs_file_operations.iopoll(iocb, iob, flags);
 }
 
+//fallocate는 extent만 고치고 데이터는 쓰지 않는다. 범위 안의 페이지 캐시는 미리 버려서 바뀐 내용을 다시 읽게 한다.
+static long hodo_file_fallocate(struct file *file, int mode, loff_t offset, loff_t len) {
+    // ZONEFS_TRACE();
+
+    struct inode *inode = file_inode(file);
+    struct hodo_inode *hodo_inode;
+    loff_t isize;
+    int ret;
+
+    //seq, cnv 아래의 zone 파일은 fallocate를 지원하지 않는다
+    if (inode->i_ino < mapping_info.starting_logical_number)
+        return -EOPNOTSUPP;
+
+    if (mode & ~(FALLOC_FL_KEEP_SIZE | FALLOC_FL_PUNCH_HOLE | FALLOC_FL_ZERO_RANGE |
+                 FALLOC_FL_COLLAPSE_RANGE | FALLOC_FL_INSERT_RANGE))
+        return -EOPNOTSUPP;
+
+    //punch hole은 파일 크기를 바꾸지 않으므로 KEEP_SIZE와 함께 와야 하고, zero range와는 함께 쓸 수 없다
+    if ((mode & FALLOC_FL_PUNCH_HOLE) &&
+        (!(mode & FALLOC_FL_KEEP_SIZE) || (mode & FALLOC_FL_ZERO_RANGE)))
+        return -EOPNOTSUPP;
+
+    //collapse와 insert는 다른 플래그 없이 혼자 와야 한다
+    if ((mode & (FALLOC_FL_COLLAPSE_RANGE | FALLOC_FL_INSERT_RANGE)) &&
+        mode != FALLOC_FL_COLLAPSE_RANGE && mode != FALLOC_FL_INSERT_RANGE)
+        return -EINVAL;
+
+    inode_lock(inode);
+    isize = i_size_read(inode);
+
+    //collapse와 insert는 블록을 통째로 옮기므로 블록 단위로 정렬된 범위만 받는다
+    if (mode & (FALLOC_FL_COLLAPSE_RANGE | FALLOC_FL_INSERT_RANGE)) {
+        ret = -EINVAL;
+        if ((offset | len) & (HODO_FILE_BLOCK_SIZE - 1))
+            goto out_unlock;
+        if ((mode & FALLOC_FL_COLLAPSE_RANGE) && offset + len >= isize)
+            goto out_unlock;
+        if ((mode & FALLOC_FL_INSERT_RANGE) && offset >= isize)
+            goto out_unlock;
+
+        ret = -EFBIG;
+        if ((mode & FALLOC_FL_INSERT_RANGE) && (uint64_t)isize + len > (uint64_t)HODO_MAX_FILE_BLOCKS * HODO_FILE_BLOCK_SIZE)
+            goto out_unlock;
+    }
+
+    ret = file_modified(file);
+    if (ret)
+        goto out_unlock;
+
+    //collapse와 insert는 offset 뒤의 내용이 모두 옮겨지므로 offset 뒤를 통째로 버린다
+    if (mode & (FALLOC_FL_COLLAPSE_RANGE | FALLOC_FL_INSERT_RANGE))
+        truncate_pagecache(inode, offset);
+    else if (mode & (FALLOC_FL_PUNCH_HOLE | FALLOC_FL_ZERO_RANGE))
+        truncate_pagecache_range(inode, offset, offset + len - 1);
+
+    hodo_inode = hodo_alloc_block();
+    hodo_lock_inode(inode);
+    hodo_read_inode(inode->i_ino, hodo_inode);
+
+    if (mode & FALLOC_FL_PUNCH_HOLE) {
+        ret = hodo_punch_hole(hodo_inode, offset, len);
+    }
+    else if (mode & FALLOC_FL_COLLAPSE_RANGE) {
+        ret = hodo_collapse_range(hodo_inode, offset, len);
+    }
+    else if (mode & FALLOC_FL_INSERT_RANGE) {
+        ret = hodo_insert_range(hodo_inode, offset, len);
+    }
+    else {
+        //구멍은 0으로 읽히므로, zero range는 범위의 블록들을 풀어주기만 하면 된다.
+        //preallocation은 쓸 공간이 남아 있는지만 확인한다. 구멍이 그대로 0으로 읽히므로 데이터를 쓸 필요가 없다.
+        if (mode & FALLOC_FL_ZERO_RANGE)
+            ret = hodo_punch_hole(hodo_inode, offset, len);
+        else
+            ret = hodo_check_preallocation(hodo_inode, offset, len);
+
+        if (!ret && !(mode & FALLOC_FL_KEEP_SIZE) && offset + len > isize)
+            ret = hodo_truncate_file(hodo_inode, offset + len);
+    }
+    hodo_unlock_inode(inode);
+
+    if (!ret) {
+        i_size_write(inode, hodo_inode->file_len);
+        inode_set_mtime_to_ts(inode, inode_set_ctime_current(inode));
+    }
+
+    hodo_free_block(hodo_inode);
+
+out_unlock:
+    inode_unlock(inode);
+    return ret;
+}
+
+//파일 범위를 복사하지 않고 블록을 공유시킨다(reflink). 공유된 블록은 어느 쪽에서든 고쳐 쓰는 순간 그 파일만 새 블록으로 옮겨 간다.
+static loff_t hodo_file_remap_range(struct file *file_in, loff_t pos_in, struct file *file_out, loff_t pos_out,
+                                    loff_t len, unsigned int remap_flags) {
+    // ZONEFS_TRACE();
+
+    struct inode *src = file_inode(file_in);
+    struct inode *dst = file_inode(file_out);
+    struct hodo_inode *src_hodo_inode;
+    struct hodo_inode *dst_hodo_inode;
+    int ret;
+
+    if (remap_flags & ~(REMAP_FILE_DEDUP | REMAP_FILE_ADVISORY))
+        return -EINVAL;
+
+    //내용을 비교해서 합치는 dedup과 zone 파일은 지원하지 않는다
+    if (remap_flags & REMAP_FILE_DEDUP)
+        return -EOPNOTSUPP;
+    if (src->i_ino < mapping_info.starting_logical_number || dst->i_ino < mapping_info.starting_logical_number)
+        return -EOPNOTSUPP;
+
+    lock_two_nondirectories(src, dst);
+
+    ret = generic_remap_file_range_prep(file_in, pos_in, file_out, pos_out, &len, remap_flags);
+    if (ret < 0 || len == 0)
+        goto out_unlock;
+
+    //블록 단위로 공유하므로 범위는 블록 단위로 정렬되어야 한다. 원본 파일의 끝까지라면 마지막 블록은 일부만 차 있어도 된다.
+    ret = -EINVAL;
+    if ((pos_in | pos_out) & (HODO_FILE_BLOCK_SIZE - 1))
+        goto out_unlock;
+    if ((len & (HODO_FILE_BLOCK_SIZE - 1)) && pos_in + len != i_size_read(src))
+        goto out_unlock;
+
+    ret = file_modified(file_out);
+    if (ret)
+        goto out_unlock;
+
+    truncate_pagecache_range(dst, pos_out, round_up(pos_out + len, HODO_FILE_BLOCK_SIZE) - 1);
+
+    //고쳐 쓰는 것은 dst의 hodo 아이노드뿐이다. src는 읽기만 하고 공유 수만 올린다.
+    hodo_lock_inode(dst);
+
+    src_hodo_inode = hodo_alloc_block();
+    hodo_read_inode(src->i_ino, src_hodo_inode);
+
+    //같은 파일 안에서 옮긴다면 같은 사본을 고쳐야 한다
+    dst_hodo_inode = src_hodo_inode;
+    if (dst != src) {
+        dst_hodo_inode = hodo_alloc_block();
+        hodo_read_inode(dst->i_ino, dst_hodo_inode);
+    }
+
+    ret = hodo_clone_range(src_hodo_inode, pos_in / HODO_FILE_BLOCK_SIZE, dst_hodo_inode, pos_out / HODO_FILE_BLOCK_SIZE,
+                           DIV_ROUND_UP(len, HODO_FILE_BLOCK_SIZE));
+    if (!ret && dst_hodo_inode->file_len < pos_out + len)
+        dst_hodo_inode->file_len = pos_out + len;
+
+    //도중에 실패했더라도 dst의 extent는 이미 바뀌었을 수 있다. 풀린 논리 번호를 가리키는 옛 아이노드가 남지 않도록 지금 상태 그대로 쓴다.
+    hodo_write_inode(dst_hodo_inode);
+    hodo_unlock_inode(dst);
+
+    if (!ret) {
+        i_size_write(dst, dst_hodo_inode->file_len);
+        inode_set_mtime_to_ts(dst, inode_set_ctime_current(dst));
+    }
+
+    if (dst_hodo_inode != src_hodo_inode)
+        hodo_free_block(dst_hodo_inode);
+    hodo_free_block(src_hodo_inode);
+
+out_unlock:
+    unlock_two_nondirectories(src, dst);
+    return ret < 0 ? ret : len;
+}
+
+//시작 위치가 블록 단위로 정렬되어 있다면 블록 단위로 떨어지는 앞부분은 reflink로 공유하고, 남은 꼬리만 페이지 캐시를 거쳐 복사한다
+static ssize_t hodo_file_copy_range(struct file *file_in, loff_t pos_in, struct file *file_out, loff_t pos_out,
+                                    size_t len, unsigned int flags) {
+    // ZONEFS_TRACE();
+
+    size_t done = 0;
+    ssize_t ret;
+
+    if (file_inode(file_in)->i_sb == file_inode(file_out)->i_sb &&
+        !((pos_in | pos_out) & (HODO_FILE_BLOCK_SIZE - 1))) {
+        //원본 파일의 끝까지 가는 범위라면 마지막 블록이 일부만 차 있어도 통째로 공유할 수 있다
+        loff_t clone_len = len;
+        if (pos_in + len < i_size_read(file_inode(file_in)))
+            clone_len = round_down(len, HODO_FILE_BLOCK_SIZE);
+
+        if (clone_len > 0) {
+            loff_t cloned = hodo_file_remap_range(file_in, pos_in, file_out, pos_out, clone_len, REMAP_FILE_CAN_SHORTEN);
+            if (cloned > 0)
+                done = cloned;
+        }
+    }
+
+    if (done == len)
+        return done;
+
+    ret = splice_copy_file_range(file_in, pos_in + done, file_out, pos_out + done, len - done);
+    if (ret < 0)
+        return done ? done : ret;
+    return done + ret;
+}
+
 static int hodo_readdir(struct file *file, struct dir_context *ctx) {
     // ZONEFS_TRACE();
 
@@ -326,7 +604,11 @@ static int hodo_readdir(struct file *file, struct dir_context *ctx) {
     }
     else {
         // pr_info("zonefs: readdir on user directory\n");
-        return hodo_sub_readdir(file, ctx);
+        uint64_t start_ns = ktime_get_ns();
+        int ret = hodo_sub_readdir(file, ctx);
+
+        hodo_latency_record(HODO_LAT_READDIR, start_ns);
+        return ret;
     }
 }
 
@@ -341,6 +623,9 @@ const struct file_operations hodo_file_operations = {
 	.splice_read	= hodo_file_splice_read,
 	.splice_write	= hodo_file_splice_write,
 	.iopoll		= hodo_file_iocb_bio_iopoll,
+	.fallocate	= hodo_file_fallocate,
+	.remap_file_range	= hodo_file_remap_range,
+	.copy_file_range	= hodo_file_copy_range,
 };
 
 const struct file_operations hodo_dir_operations = {
@@ -380,58 +665,84 @@ static struct dentry *hodo_lookup(struct inode *dir, struct dentry *dentry, unsi
 
     //그 외는 우리가 정의한 hodo sub lookup 사용
     // pr_info("zonefs: using custom lookup for '%s' (parent: %s)\n", name, parent);
-    return hodo_sub_lookup(dir, dentry, flags);
+    uint64_t start_ns = ktime_get_ns();
+    struct dentry *ret = hodo_sub_lookup(dir, dentry, flags);
+
+    hodo_latency_record(HODO_LAT_LOOKUP, start_ns);
+    return ret;
 }
 
 static int hodo_create(struct mnt_idmap *idmap, struct inode *dir, struct dentry *dentry, umode_t mode, bool excl) {
     // ZONEFS_TRACE();
 
+    hodo_stat_inc(HODO_STAT_CREATE);
+
+    uint64_t start_ns = ktime_get_ns();
     struct inode *inode;
     struct timespec64 now;
-    struct hodo_inode hinode;
+    struct hodo_inode *hinode = hodo_alloc_block();
+    memset(hinode, 0, sizeof(struct hodo_inode));
 
     inode = new_inode(dir->i_sb);
     now = current_time(inode);
 
     // 여기부터 hinode 초기화: 함수로 리팩터링
-    hinode.magic[0] = 'I';
-    hinode.magic[1] = 'N';
-    hinode.magic[2] = 'O';
-    hinode.magic[3] = 'D';
+    hinode->magic[0] = 'I';
+    hinode->magic[1] = 'N';
+    hinode->magic[2] = 'O';
+    hinode->magic[3] = 'D';
 
-    hinode.file_len = 0;
+    hinode->file_len = 0;
 
-    hinode.name_len = dentry->d_name.len; 
-    if (hinode.name_len > HODO_MAX_NAME_LEN) {
+    hinode->name_len = dentry->d_name.len; 
+    if (hinode->name_len > HODO_MAX_NAME_LEN) {
         // 구현해야 될 부분: error handling
     }
-    memcpy(hinode.name, dentry->d_name.name, hinode.name_len);
+    memcpy(hinode->name, dentry->d_name.name, hinode->name_len);
 
-    hinode.type = HODO_TYPE_REG;
+    hinode->type = HODO_TYPE_REG;
 
-    hinode.i_ino = hodo_get_next_logical_number();
+    //아이노드 번호도 논리 번호에서 받으므로, 남은 번호가 없으면 만들지 않는다
+    int ino = hodo_get_next_logical_number();
+    if (ino < 0) {
+        hodo_free_block(hinode);
+        iput(inode);
+        return ino;
+    }
+    hinode->i_ino = ino;
 
-    hinode.i_mode = S_IFREG | mode; 
+    hinode->i_mode = S_IFREG | mode; 
 
-    hinode.i_uid = current_fsuid();
-    hinode.i_gid = current_fsgid();
+    hinode->i_uid = current_fsuid();
+    hinode->i_gid = current_fsgid();
 
-    hinode.i_nlink = 1;
+    hinode->i_nlink = 1;
 
-    hinode.i_atime = now;
-    hinode.i_mtime = now;
-    hinode.i_ctime = now;
+    hinode->i_atime = now;
+    hinode->i_mtime = now;
+    hinode->i_ctime = now;
 
-    logical_block_number_t hinode_logical_number = hinode.i_ino;
-    hodo_write_struct(&hinode, sizeof(struct hodo_inode), &hinode_logical_number);
+    //새 아이노드와 dirent를 한 트랜잭션으로 모아 쓴다
+    struct hodo_trans_handle trans;
+    hodo_trans_begin(&trans);
+    hodo_write_inode(hinode);
 
-    add_dirent(dir, &hinode);
+    //dirent 자리가 없으면 방금 쓴 아이노드와 논리 번호를 되돌린다
+    if (add_dirent(dir, hinode) < 0) {
+        hodo_evict_inode(hinode->i_ino);
+        hodo_trans_end(&trans);
+        hodo_free_block(hinode);
+        iput(inode);
+        return -ENOSPC;
+    }
+    hodo_trans_end(&trans);
     dir->i_size++;
 
-    inode->i_ino  = hinode.i_ino;
+    inode->i_ino  = hinode->i_ino;
     inode->i_sb   = dir->i_sb;
     inode->i_op   = &hodo_file_inode_operations;
     inode->i_fop  = &hodo_file_operations;
+    inode->i_mapping->a_ops = &hodo_file_aops;
     inode->i_mode = S_IFREG | mode;
     inode->i_uid  = current_fsuid();
     inode->i_gid  = current_fsgid();
@@ -440,8 +751,13 @@ static int hodo_create(struct mnt_idmap *idmap, struct inode *dir, struct dentry
     inode_set_atime_to_ts(inode, now);
     inode_set_mtime_to_ts(inode, now);
 
+    //lookup이 iget_locked로 같은 VFS 아이노드를 찾을 수 있도록 해시에 올린다
+    insert_inode_hash(inode);
+
+    hodo_free_block(hinode);
     d_add(dentry, inode);
 
+    hodo_latency_record(HODO_LAT_CREATE, start_ns);
     return 0;
 }
 
@@ -451,7 +767,6 @@ static int hodo_unlink(struct inode *dir,struct dentry *dentry) {
     struct timespec64 now;
     now = current_time(dir);
     inode_set_ctime_to_ts(dir, now);
-    inode_set_atime_to_ts(dir, now);
     inode_set_mtime_to_ts(dir, now);
 
     //'seq', 'cnv' 디렉토리 속 파일은 삭제되어선 안된다
@@ -464,42 +779,46 @@ static int hodo_unlink(struct inode *dir,struct dentry *dentry) {
         return 0;
     }
 
+    hodo_stat_inc(HODO_STAT_UNLINK);
+
+    uint64_t start_ns = ktime_get_ns();
+
+    //링크 수를 줄인 아이노드와 dirent를 지운 디렉토리 블록들을 한 트랜잭션으로 모아 쓴다
+    struct hodo_trans_handle trans;
+    hodo_trans_begin(&trans);
+
     //루트 디렉토리는 i_ino와 무관하게 매핑 테이블의 0번째 인덱스에 위치하므로, 수동으로 인덱스를 결정한다
     uint64_t parent_mapping_index;
-    uint64_t target_mapping_index;
     if (dir == dentry->d_sb->s_root->d_inode) {
         // pr_info("zonefs: unlink in root directory\n"); 
         parent_mapping_index = mapping_info.starting_logical_number;
-        target_mapping_index = dentry->d_inode->i_ino;
     }
     else {
         // pr_info("zonefs: unlink in non-root directory\n"); 
         parent_mapping_index = dir->i_ino;
-        target_mapping_index = dentry->d_inode->i_ino;
     }
 
-    //매핑 테이블에서 삭제 파일에 관한 행은 이제 쓰이지 않으므로, 비트맵에서 invalid(0)으로 표시한다
-    hodo_erase_table_entry(target_mapping_index);
-
-    //target hodo_inode의 i_nlink 수를 0으로 곤치고서 저장장치에 append 하기
-    struct hodo_inode target_inode;
-    logical_block_number_t target_inode_logical_number;
-
-    target_inode_logical_number = target_mapping_index;
-    hodo_read_struct(target_inode_logical_number, &target_inode, sizeof(struct hodo_inode));
-    
-    target_inode.i_nlink = 0;
-    
-    hodo_write_struct(&target_inode, sizeof(struct hodo_inode), &target_inode_logical_number);
+    //삭제 파일의 블록들은 마지막 iput(zonefs_evict_inode)에서 풀어준다. 파일이 아직 열려 있다면 그때까지 읽고 쓸 수 있어야 하기 때문이다.
+    hodo_sub_drop_link(d_inode(dentry), now);
 
     //부모 디렉토리 hodo_inode가 가리키는 직간접적인 데이터블럭에서 삭제 파일의 hodo_dirent를 삭제하고 hodo_inode까지 새로 쓰기
-    struct hodo_inode parent_inode;
+    struct hodo_inode *parent_inode = hodo_alloc_block();
     logical_block_number_t parent_inode_logical_number;
 
     parent_inode_logical_number = parent_mapping_index;
-    hodo_read_struct(parent_inode_logical_number, &parent_inode, sizeof(struct hodo_inode));
+    hodo_lock_inode(dir);
+    hodo_read_inode(parent_inode_logical_number, parent_inode);
     
-    remove_dirent(&parent_inode, dir, target_name, &parent_inode_logical_number);
+    remove_dirent(parent_inode, dir, target_name);
+    hodo_unlock_inode(dir);
+    hodo_free_block(parent_inode);
+
+    //지운 것이 디렉토리라면 그 '..'이 사라지므로 부모 디렉토리의 nlink수도 줄인다
+    if (S_ISDIR(d_inode(dentry)->i_mode)) {
+        hodo_sub_drop_dir_nlink(dir);
+        hodo_sub_write_nlink(dir);
+    }
+    hodo_trans_end(&trans);
 
     //자식 파일이 삭제되었으므로 부모 디렉토리의 VFS 아이노드의 'i_size'을 감소시킨다
     dir->i_size--;
@@ -507,55 +826,84 @@ static int hodo_unlink(struct inode *dir,struct dentry *dentry) {
     //VFS 덴트리 캐시 드랍하기
     d_drop(dentry);
     d_add(dentry, NULL);
+
+    hodo_latency_record(HODO_LAT_UNLINK, start_ns);
     return 0;
 }
 
 static int hodo_mkdir(struct mnt_idmap *idmap, struct inode *dir, struct dentry *dentry, umode_t mode) {
     // ZONEFS_TRACE();
 
+    uint64_t start_ns = ktime_get_ns();
     struct inode *inode;
     struct timespec64 now;
-    struct hodo_inode hinode;
+    struct hodo_inode *hinode = hodo_alloc_block();
+    memset(hinode, 0, sizeof(struct hodo_inode));
 
     inode = new_inode(dir->i_sb);
     now = current_time(inode);
 
     // 여기부터 hinode 초기화: 함수로 리팩터링
-    hinode.magic[0] = 'I';
-    hinode.magic[1] = 'N';
-    hinode.magic[2] = 'O';
-    hinode.magic[3] = 'D';
+    hinode->magic[0] = 'I';
+    hinode->magic[1] = 'N';
+    hinode->magic[2] = 'O';
+    hinode->magic[3] = 'D';
 
-    hinode.file_len = 2;
+    hinode->file_len = 2;
 
-    hinode.name_len = dentry->d_name.len; 
-    if (hinode.name_len > HODO_MAX_NAME_LEN) {
+    hinode->name_len = dentry->d_name.len; 
+    if (hinode->name_len > HODO_MAX_NAME_LEN) {
         // 구현해야 될 부분: error handling
     }
-    memcpy(hinode.name, dentry->d_name.name, hinode.name_len);
+    memcpy(hinode->name, dentry->d_name.name, hinode->name_len);
+
+    hinode->type = HODO_TYPE_DIR;
 
-    hinode.type = HODO_TYPE_DIR;
+    // 새 디렉토리는 dirent들을 아이노드 안에 보관하다가, 넘치면 데이터블록으로 옮긴다
+    hinode->i_flags = HODO_INODE_INLINE_DIRENT;
 
-    hinode.i_ino = hodo_get_next_logical_number();
+    //아이노드 번호도 논리 번호에서 받으므로, 남은 번호가 없으면 만들지 않는다
+    int ino = hodo_get_next_logical_number();
+    if (ino < 0) {
+        hodo_free_block(hinode);
+        iput(inode);
+        return ino;
+    }
+    hinode->i_ino = ino;
+
+    hinode->i_mode = S_IFDIR | mode; 
 
-    hinode.i_mode = S_IFDIR | mode; 
+    hinode->i_uid = current_fsuid();
+    hinode->i_gid = current_fsgid();
 
-    hinode.i_uid = current_fsuid();
-    hinode.i_gid = current_fsgid();
+    //디렉토리의 링크 수는 부모의 dirent와 자신의 '.'으로 2에서 시작하고, 하위 디렉토리의 '..'마다 하나씩 늘어난다
+    hinode->i_nlink = 2;
 
-    hinode.i_nlink = 1;
+    hinode->i_atime = now;
+    hinode->i_mtime = now;
+    hinode->i_ctime = now;
 
-    hinode.i_atime = now;
-    hinode.i_mtime = now;
-    hinode.i_ctime = now;
+    struct hodo_trans_handle trans;
+    hodo_trans_begin(&trans);
+    hodo_write_inode(hinode);
 
-    logical_block_number_t hodo_inode_logical_number = hinode.i_ino;
-    hodo_write_struct(&hinode, sizeof(struct hodo_inode), &hodo_inode_logical_number);
+    //dirent 자리가 없으면 방금 쓴 아이노드와 논리 번호를 되돌린다
+    if (add_dirent(dir, hinode) < 0) {
+        hodo_evict_inode(hinode->i_ino);
+        hodo_trans_end(&trans);
+        hodo_free_block(hinode);
+        iput(inode);
+        return -ENOSPC;
+    }
 
-    add_dirent(dir, &hinode);
+    //새 디렉토리의 '..'이 부모를 가리키므로 부모의 링크 수가 하나 는다
+    inc_nlink(dir);
+    hodo_sub_write_nlink(dir);
+    hodo_trans_end(&trans);
 
+    set_nlink(inode, 2);
     inode->i_size = 2;
-    inode->i_ino  = hinode.i_ino;
+    inode->i_ino  = hinode->i_ino;
     inode->i_sb   = dir->i_sb;
     inode->i_op   = &hodo_dir_inode_operations;
     inode->i_fop  = &hodo_dir_operations;
@@ -567,10 +915,16 @@ static int hodo_mkdir(struct mnt_idmap *idmap, struct inode *dir, struct dentry
     inode_set_atime_to_ts(inode, now);
     inode_set_mtime_to_ts(inode, now);
 
+    //lookup이 iget_locked로 같은 VFS 아이노드를 찾을 수 있도록 해시에 올린다
+    insert_inode_hash(inode);
+
+    hodo_free_block(hinode);
     d_add(dentry, inode);
 
-    GC();
+    if (GC_timing())
+        GC();
 
+    hodo_latency_record(HODO_LAT_MKDIR, start_ns);
     return 0;
 }
 
@@ -590,13 +944,316 @@ static int hodo_rmdir(struct inode *dir, struct dentry *dentry){
     if(!check_directory_empty(dentry))
         return -ENOTEMPTY;
 
-    //그 외엔 부모 디렉토리의 nlink수를 줄이고, .unlink(..)를 활용해 rmdir을 수행한다.
-    drop_nlink(dir);
+    //그 외엔 .unlink(..)를 활용해 rmdir을 수행한다. 부모 디렉토리의 nlink수는 unlink가 dirent와 함께 줄인다.
     return hodo_unlink(dir, dentry);
 }
 
+//rename은 dirent만 옮기고 파일 데이터는 건드리지 않는다. dirent가 든 블록(또는 inline 디렉토리의 아이노드)과 옮겨지는 아이노드만 새로 쓴다.
+static int hodo_rename(struct mnt_idmap *idmap, struct inode *old_dir, struct dentry *old_dentry,
+                       struct inode *new_dir, struct dentry *new_dentry, unsigned int flags) {
+    // ZONEFS_TRACE();
+
+    const char *old_name = old_dentry->d_name.name;
+    const char *new_name = new_dentry->d_name.name;
+    struct inode *source = d_inode(old_dentry);
+    struct inode *target = d_inode(new_dentry);
+
+    //seq, cnv 디렉토리와 그 아래의 zone 파일은 옮길 수 없다
+    if (!strcmp(old_name, "seq") || !strcmp(old_name, "cnv") ||
+        !strcmp(old_dentry->d_parent->d_name.name, "seq") || !strcmp(old_dentry->d_parent->d_name.name, "cnv") ||
+        !strcmp(new_dentry->d_parent->d_name.name, "seq") || !strcmp(new_dentry->d_parent->d_name.name, "cnv"))
+        return -EPERM;
+
+    if (flags & ~(RENAME_NOREPLACE | RENAME_EXCHANGE))
+        return -EINVAL;
+
+    if (new_dentry->d_name.len > HODO_MAX_NAME_LEN || old_dentry->d_name.len > HODO_MAX_NAME_LEN)
+        return -ENAMETOOLONG;
+
+    //덮어쓰일 디렉토리는 비어 있어야 한다
+    if (target && !(flags & RENAME_EXCHANGE) && S_ISDIR(target->i_mode) && !check_directory_empty(new_dentry))
+        return -ENOTEMPTY;
+
+    struct timespec64 now = current_time(old_dir);
+    struct hodo_inode *source_hodo_inode = hodo_alloc_block();
+    int ret = 0;
+
+    //옮겨지는 아이노드들과 양쪽 디렉토리 블록들을 한 트랜잭션으로 모아 쓴다
+    struct hodo_trans_handle trans;
+    hodo_trans_begin(&trans);
+
+    //dirent는 아이노드의 이름으로 만들어지므로 새 이름을 적은 사본을 만든다. 아이노드 자체는 hodo_sub_write_name이 lock을 잡고 고친다.
+    hodo_read_inode(source->i_ino, source_hodo_inode);
+    source_hodo_inode->name_len = new_dentry->d_name.len;
+    memset(source_hodo_inode->name, 0, HODO_MAX_NAME_LEN);
+    memcpy(source_hodo_inode->name, new_name, source_hodo_inode->name_len);
+
+    if (flags & RENAME_EXCHANGE) {
+        struct hodo_inode *target_hodo_inode = hodo_alloc_block();
+
+        hodo_read_inode(target->i_ino, target_hodo_inode);
+        target_hodo_inode->name_len = old_dentry->d_name.len;
+        memset(target_hodo_inode->name, 0, HODO_MAX_NAME_LEN);
+        memcpy(target_hodo_inode->name, old_name, target_hodo_inode->name_len);
+
+        hodo_sub_write_name(source, &new_dentry->d_name, now);
+        hodo_sub_write_name(target, &old_dentry->d_name, now);
+
+        //두 dirent가 서로의 아이노드를 가리키게 바꾼다
+        hodo_sub_replace_dirent(old_dir, old_name, target_hodo_inode);
+        hodo_sub_replace_dirent(new_dir, new_name, source_hodo_inode);
+
+        inode_set_ctime_to_ts(target, now);
+        hodo_free_block(target_hodo_inode);
+    }
+    else if (target) {
+        //덮어쓰는 경우에는 target의 dirent가 source를 가리키게 바꾸고 source의 dirent를 지운다
+        hodo_sub_write_name(source, &new_dentry->d_name, now);
+
+        hodo_sub_replace_dirent(new_dir, new_name, source_hodo_inode);
+        hodo_sub_remove_dirent(old_dir, old_name);
+        old_dir->i_size--;
+
+        //target의 블록들은 마지막 iput(zonefs_evict_inode)에서 풀린다
+        hodo_sub_drop_link(target, now);
+    }
+    else {
+        //새 이름의 dirent를 먼저 더하고 옛 이름을 지운다. 도중에 멈추더라도 파일이 사라지지는 않는다.
+        if (add_dirent(new_dir, source_hodo_inode) < 0) {
+            ret = -ENOSPC;
+            goto out;
+        }
+        new_dir->i_size++;
+        hodo_sub_write_name(source, &new_dentry->d_name, now);
+
+        hodo_sub_remove_dirent(old_dir, old_name);
+        old_dir->i_size--;
+    }
+
+    //디렉토리가 다른 부모로 옮겨지면 그 '..'도 따라가므로 양쪽 부모의 nlink수를 고친다. 덮어쓰인 디렉토리의 '..'은 사라진다.
+    bool source_is_dir = S_ISDIR(source->i_mode);
+    bool target_is_dir = target && S_ISDIR(target->i_mode);
+
+    if (flags & RENAME_EXCHANGE) {
+        if (old_dir != new_dir && source_is_dir && !target_is_dir) {
+            hodo_sub_drop_dir_nlink(old_dir);
+            inc_nlink(new_dir);
+        }
+        else if (old_dir != new_dir && !source_is_dir && target_is_dir) {
+            hodo_sub_drop_dir_nlink(new_dir);
+            inc_nlink(old_dir);
+        }
+    }
+    else {
+        if (target_is_dir)
+            hodo_sub_drop_dir_nlink(new_dir);
+        if (source_is_dir && old_dir != new_dir) {
+            hodo_sub_drop_dir_nlink(old_dir);
+            inc_nlink(new_dir);
+        }
+    }
+
+    if (source_is_dir || target_is_dir) {
+        hodo_sub_write_nlink(old_dir);
+        if (new_dir != old_dir)
+            hodo_sub_write_nlink(new_dir);
+    }
+
+    inode_set_ctime_to_ts(source, now);
+    inode_set_mtime_to_ts(old_dir, inode_set_ctime_to_ts(old_dir, now));
+    inode_set_mtime_to_ts(new_dir, inode_set_ctime_to_ts(new_dir, now));
+
+out:
+    hodo_trans_end(&trans);
+    hodo_free_block(source_hodo_inode);
+    return ret;
+}
+
+//hodo 파일의 extent들을 물리적으로 이어진 구간 단위로 알려준다. zone 파일은 zone 하나가 통째로 파일이므로 알려줄 것이 없다.
+static int hodo_fiemap(struct inode *inode, struct fiemap_extent_info *fieinfo, u64 start, u64 len) {
+    // ZONEFS_TRACE();
+
+    if (inode->i_ino < mapping_info.starting_logical_number)
+        return -EOPNOTSUPP;
+
+    int ret;
+
+    inode_lock_shared(inode);
+    ret = iomap_fiemap(inode, fieinfo, start, len, &hodo_read_iomap_ops);
+    inode_unlock_shared(inode);
+
+    return ret;
+}
+
+//하드 링크는 같은 아이노드를 가리키는 dirent를 하나 더 만든다. 데이터는 건드리지 않고 아이노드의 i_nlink와 dirent 하나만 새로 쓴다.
+static int hodo_link(struct dentry *old_dentry, struct inode *dir, struct dentry *dentry) {
+    // ZONEFS_TRACE();
+
+    struct inode *inode = d_inode(old_dentry);
+
+    //zone 파일은 hodo 아이노드가 없고, seq, cnv 디렉토리에는 이름을 더할 수 없다
+    if (inode->i_ino < mapping_info.starting_logical_number ||
+        !strcmp(dentry->d_parent->d_name.name, "seq") || !strcmp(dentry->d_parent->d_name.name, "cnv"))
+        return -EPERM;
+
+    if (dentry->d_name.len > HODO_MAX_NAME_LEN)
+        return -ENAMETOOLONG;
+
+    struct timespec64 now = current_time(inode);
+    struct hodo_inode *hodo_inode = hodo_alloc_block();
+
+    //dirent보다 i_nlink를 먼저 올려 둔다. 도중에 멈추더라도 링크 수가 모자라 살아 있는 이름의 블록이 풀리는 일은 없다.
+    struct hodo_trans_handle trans;
+    hodo_trans_begin(&trans);
+    hodo_lock_inode(inode);
+    hodo_read_inode(inode->i_ino, hodo_inode);
+    hodo_inode->i_nlink++;
+    hodo_inode->i_ctime = now;
+    hodo_write_inode(hodo_inode);
+    hodo_unlock_inode(inode);
+
+    //dirent는 아이노드의 이름으로 만들어지므로 새 이름은 메모리 위의 사본에만 적는다. 아이노드에는 처음 이름이 남는다.
+    hodo_inode->name_len = dentry->d_name.len;
+    memset(hodo_inode->name, 0, HODO_MAX_NAME_LEN);
+    memcpy(hodo_inode->name, dentry->d_name.name, hodo_inode->name_len);
+
+    if (add_dirent(dir, hodo_inode) < 0) {
+        hodo_lock_inode(inode);
+        hodo_read_inode(inode->i_ino, hodo_inode);
+        hodo_inode->i_nlink--;
+        hodo_write_inode(hodo_inode);
+        hodo_unlock_inode(inode);
+        hodo_trans_end(&trans);
+        hodo_free_block(hodo_inode);
+        return -ENOSPC;
+    }
+    hodo_trans_end(&trans);
+    hodo_free_block(hodo_inode);
+
+    dir->i_size++;
+    inode_set_mtime_to_ts(dir, inode_set_ctime_to_ts(dir, now));
+    inode_set_ctime_to_ts(inode, now);
+
+    inc_nlink(inode);
+    ihold(inode);
+    d_instantiate(dentry, inode);
+    return 0;
+}
+
+//symlink의 대상 경로는 hodo 아이노드의 inline 영역(i_link)에 담는다. 만들 때는 아이노드 블록과 dirent 하나씩만 쓰고, 따라갈 때는 아이노드 블록 하나만 읽는다.
+static int hodo_symlink(struct mnt_idmap *idmap, struct inode *dir, struct dentry *dentry, const char *symname) {
+    // ZONEFS_TRACE();
+
+    size_t link_len = strlen(symname);
+
+    if (!strcmp(dentry->d_parent->d_name.name, "seq") || !strcmp(dentry->d_parent->d_name.name, "cnv"))
+        return -EPERM;
+
+    if (dentry->d_name.len > HODO_MAX_NAME_LEN ||
+        link_len >= sizeof(((struct hodo_inode *)0)->i_link))
+        return -ENAMETOOLONG;
+
+    struct inode *inode = new_inode(dir->i_sb);
+    if (!inode)
+        return -ENOMEM;
+
+    struct timespec64 now = current_time(inode);
+    struct hodo_inode *hinode = hodo_alloc_block();
+    memset(hinode, 0, sizeof(struct hodo_inode));
+
+    hinode->magic[0] = 'I';
+    hinode->magic[1] = 'N';
+    hinode->magic[2] = 'O';
+    hinode->magic[3] = 'D';
+
+    hinode->i_flags = HODO_INODE_INLINE_LINK;
+    hinode->file_len = link_len;
+
+    hinode->name_len = dentry->d_name.len;
+    memcpy(hinode->name, dentry->d_name.name, hinode->name_len);
+
+    hinode->type = HODO_TYPE_LNK;
+    //아이노드 번호도 논리 번호에서 받으므로, 남은 번호가 없으면 만들지 않는다
+    int ino = hodo_get_next_logical_number();
+    if (ino < 0) {
+        hodo_free_block(hinode);
+        iput(inode);
+        return ino;
+    }
+    hinode->i_ino = ino;
+    hinode->i_mode = S_IFLNK | 0777;
+    hinode->i_uid = current_fsuid();
+    hinode->i_gid = current_fsgid();
+    hinode->i_nlink = 1;
+
+    hinode->i_atime = now;
+    hinode->i_mtime = now;
+    hinode->i_ctime = now;
+
+    memcpy(hinode->i_link, symname, link_len);
+
+    struct hodo_trans_handle trans;
+    hodo_trans_begin(&trans);
+    hodo_write_inode(hinode);
+
+    //dirent 자리가 없으면 방금 쓴 아이노드와 논리 번호를 되돌린다
+    if (add_dirent(dir, hinode) < 0) {
+        hodo_evict_inode(hinode->i_ino);
+        hodo_trans_end(&trans);
+        hodo_free_block(hinode);
+        iput(inode);
+        return -ENOSPC;
+    }
+    hodo_trans_end(&trans);
+    dir->i_size++;
+    inode_set_mtime_to_ts(dir, inode_set_ctime_to_ts(dir, now));
+
+    inode->i_ino  = hinode->i_ino;
+    inode->i_sb   = dir->i_sb;
+    inode->i_op   = &hodo_symlink_inode_operations;
+    inode->i_mode = S_IFLNK | 0777;
+    inode->i_uid  = current_fsuid();
+    inode->i_gid  = current_fsgid();
+    i_size_write(inode, link_len);
+
+    inode_set_ctime_to_ts(inode, now);
+    inode_set_atime_to_ts(inode, now);
+    inode_set_mtime_to_ts(inode, now);
+
+    insert_inode_hash(inode);
+
+    hodo_free_block(hinode);
+    d_instantiate(dentry, inode);
+    return 0;
+}
+
+static const char *hodo_get_link(struct dentry *dentry, struct inode *inode, struct delayed_call *done) {
+    // ZONEFS_TRACE();
+
+    //RCU 경로 탐색 중에는 장치를 읽을 수 없으므로, 참조를 잡은 탐색으로 다시 불러 달라고 한다
+    if (!dentry)
+        return ERR_PTR(-ECHILD);
+
+    struct hodo_inode *hodo_inode = hodo_alloc_block();
+    char *link;
+
+    if (hodo_read_inode(inode->i_ino, hodo_inode) < 0 || !(hodo_inode->i_flags & HODO_INODE_INLINE_LINK)) {
+        hodo_free_block(hodo_inode);
+        return ERR_PTR(-EIO);
+    }
+
+    link = kstrndup(hodo_inode->i_link, sizeof(hodo_inode->i_link) - 1, GFP_KERNEL);
+    hodo_free_block(hodo_inode);
+    if (!link)
+        return ERR_PTR(-ENOMEM);
+
+    set_delayed_call(done, kfree_link, link);
+    return link;
+}
+
 const struct inode_operations hodo_file_inode_operations = {
     .setattr = hodo_setattr,
+    .fiemap  = hodo_fiemap,
 };
 
 const struct inode_operations hodo_dir_inode_operations = {
@@ -606,17 +1263,108 @@ const struct inode_operations hodo_dir_inode_operations = {
     .unlink     = hodo_unlink,
     .mkdir      = hodo_mkdir,
     .rmdir      = hodo_rmdir, 
+    .rename     = hodo_rename,
+    .link       = hodo_link,
+    .symlink    = hodo_symlink,
 };
 
+const struct inode_operations hodo_symlink_inode_operations = {
+    .get_link   = hodo_get_link,
+    .setattr    = hodo_setattr,
+};
+
+/*-------------------------------------------------------------iomap 오퍼레이션 함수-------------------------------------------------------------------------------*/
+//파일 범위를 장치 범위로 매핑한다. 논리 번호가 이어져도 물리 위치는 떨어져 있을 수 있으므로, 한 zone 안에서 물리적으로 이어지는 만큼만 한 번에 매핑한다.
+static int hodo_read_iomap_begin(struct inode *inode, loff_t offset, loff_t length, unsigned int flags,
+                                 struct iomap *iomap, struct iomap *srcmap) {
+    // ZONEFS_TRACE();
+
+    struct hodo_inode *file_inode = hodo_alloc_block();
+    hodo_read_inode(inode->i_ino, file_inode);
+
+    uint32_t file_block = offset / HODO_FILE_BLOCK_SIZE;
+    uint32_t extent_len;
+    logical_block_number_t logical_block_number = hodo_extent_lookup(file_inode, file_block, &extent_len);
+    hodo_free_block(file_inode);
+
+    iomap->bdev = inode->i_sb->s_bdev;
+    iomap->offset = (loff_t)file_block * HODO_FILE_BLOCK_SIZE;
+
+    //요청 범위 밖까지 매핑할 필요는 없다
+    uint64_t request_blocks = DIV_ROUND_UP(offset + length - iomap->offset, HODO_FILE_BLOCK_SIZE);
+    if (extent_len > request_blocks)
+        extent_len = request_blocks;
+
+    if (!is_block_logical_number_valid(logical_block_number)) {
+        iomap->type = IOMAP_HOLE;
+        iomap->addr = IOMAP_NULL_ADDR;
+        iomap->length = (loff_t)extent_len * HODO_FILE_BLOCK_SIZE;
+        return 0;
+    }
+
+    struct hodo_block_pos start_pos = hodo_get_block_pos(logical_block_number);
+    uint32_t nr_blocks = 1;
+
+    while (nr_blocks < extent_len) {
+        struct hodo_block_pos block_pos = hodo_get_block_pos(logical_block_number + nr_blocks);
+
+        if (block_pos.zone_id != start_pos.zone_id || block_pos.block_index != start_pos.block_index + nr_blocks)
+            break;
+        nr_blocks++;
+    }
+
+    iomap->type = IOMAP_MAPPED;
+    iomap->addr = hodo_get_device_address(inode->i_sb, start_pos);
+    iomap->length = (loff_t)nr_blocks * HODO_FILE_BLOCK_SIZE;
+
+    return 0;
+}
+
+static const struct iomap_ops hodo_read_iomap_ops = {
+    .iomap_begin = hodo_read_iomap_begin,
+};
+
+//hodo_read_iomap_ops가 구멍을 IOMAP_HOLE로 알려주므로, 구멍을 찾는 데 장치를 읽을 필요가 없다
+static loff_t hodo_sub_file_llseek(struct file *filp, loff_t offset, int whence) {
+    // ZONEFS_TRACE();
+
+    struct inode *inode = file_inode(filp);
+
+    inode_lock_shared(inode);
+    if (whence == SEEK_DATA)
+        offset = iomap_seek_data(inode, offset, &hodo_read_iomap_ops);
+    else
+        offset = iomap_seek_hole(inode, offset, &hodo_read_iomap_ops);
+    inode_unlock_shared(inode);
+
+    if (offset < 0)
+        return offset;
+
+    return vfs_setpos(filp, offset, inode->i_sb->s_maxbytes);
+}
+
 /*-------------------------------------------------------------주소공간 오퍼레이션 함수-------------------------------------------------------------------------------*/
+//hodo 파일의 페이지 캐시는 hodo_read_iomap_ops로 채운다. 매핑 테이블을 거쳐 물리적으로 이어진 블록들을 bio 하나로 읽는다.
 static int hodo_read_folio(struct file *file, struct folio *folio) {
     // ZONEFS_TRACE();
-    return zonefs_file_aops.read_folio(file, folio);
+
+    //CNV, SEQ 디렉토리 아래에 속한 파일은 기존 zonefs read_folio를 호출
+    if (folio->mapping->host->i_ino < mapping_info.starting_logical_number)
+        return zonefs_file_aops.read_folio(file, folio);
+
+    return iomap_read_folio(folio, &hodo_read_iomap_ops);
 }
 
+//VFS가 순차 읽기를 감지해 readahead 창을 키워 가며 호출한다. 창 안의 블록들은 비동기로 읽히므로 사용자가 앞부분을 복사하는 동안 뒷부분의 I/O가 진행된다.
 static void hodo_readahead(struct readahead_control *rac) {
     // ZONEFS_TRACE();
-    zonefs_file_aops.readahead(rac);
+
+    if (rac->mapping->host->i_ino < mapping_info.starting_logical_number) {
+        zonefs_file_aops.readahead(rac);
+        return;
+    }
+
+    iomap_readahead(rac, &hodo_read_iomap_ops);
 }
 
 static int hodo_writepages(struct address_space *mapping,
@@ -679,14 +1427,12 @@ const struct address_space_operations hodo_file_aops = {
 static struct dentry *hodo_sub_lookup(struct inode* dir, struct dentry* dentry, unsigned int flags) {
     // ZONEFS_TRACE();
 
+    hodo_stat_inc(HODO_STAT_LOOKUP);
+
     const char *name = dentry->d_name.name;
     const char *parent = dentry->d_parent->d_name.name;
 
-    struct timespec64 now;
-    now = current_time(dir);
-    inode_set_ctime_to_ts(dir, now);
-    inode_set_atime_to_ts(dir, now);
-    inode_set_mtime_to_ts(dir, now);
+    //lookup은 디렉토리를 바꾸지 않으므로 시각도 건드리지 않는다
 
     //부모 디렉토리의 hodo 아이노드를 읽어온다
     //루트 노드의 hodo 아이노드 상의 번호는 vfs 아이노드 상의 번호와 달리 0번이니 조작한다 
@@ -698,57 +1444,77 @@ static struct dentry *hodo_sub_lookup(struct inode* dir, struct dentry* dentry,
     else
         parent_hodo_inode_logical_number = parent_hodo_inode_number;
 
-    struct hodo_inode parent_hodo_inode;
-    hodo_read_struct(parent_hodo_inode_logical_number, &parent_hodo_inode, sizeof(struct hodo_inode));
+    struct hodo_inode *parent_hodo_inode = hodo_alloc_block();
+    hodo_read_inode(parent_hodo_inode_logical_number, parent_hodo_inode);
 
     //찾고자 하는 이름을 가진 hodo 아이노드를 읽어온다
     //해당 이름의 아이노드가 저장장치에 없다면, 그냥 없다고 보고하자
-    uint64_t target_hodo_inode_number = find_inode_number(&parent_hodo_inode, name);
+    uint64_t target_hodo_inode_number = find_inode_number(parent_hodo_inode, name);
+    hodo_free_block(parent_hodo_inode);
 
     if(target_hodo_inode_number == NOTHING_FOUND){
         d_add(dentry, NULL);
         return dentry;
     }
 
+    //같은 아이노드를 가리키는 다른 이름(하드 링크)으로 이미 만들어 둔 VFS 아이노드가 있다면 그대로 이어준다
+    struct inode *vfs_inode = iget_locked(dir->i_sb, target_hodo_inode_number);
+    if (!vfs_inode)
+        return ERR_PTR(-ENOMEM);
+    if (!(vfs_inode->i_state & I_NEW))
+        return d_splice_alias(vfs_inode, dentry);
+
     // pr_info("zonefs: target hodo inode number: %d\n", target_hodo_inode_number);
     logical_block_number_t target_hodo_inode_logical_number = target_hodo_inode_number;
-    struct hodo_inode target_hodo_inode = { 0, };
-    hodo_read_struct(target_hodo_inode_logical_number, &target_hodo_inode, sizeof(struct hodo_inode));
+    struct hodo_inode *target_hodo_inode = hodo_alloc_block();
+    memset(target_hodo_inode, 0, sizeof(struct hodo_inode));
+    hodo_read_inode(target_hodo_inode_logical_number, target_hodo_inode);
 
     //찾던 이름의 hodo 아이노드 정보를 통해 VFS 아이노드를 구성하자
-    struct inode *vfs_inode = new_inode(dir->i_sb);
-    if (!vfs_inode)
-        return ERR_PTR(-ENOMEM);
+    vfs_inode->i_ino    = target_hodo_inode->i_ino;
+    vfs_inode->i_mode   = target_hodo_inode->i_mode;
+    vfs_inode->i_uid    = target_hodo_inode->i_uid;
+    vfs_inode->i_gid    = target_hodo_inode->i_gid;
+    //예전에 만든 디렉토리는 링크 수 1로 저장되어 있으므로, 디렉토리는 '.'까지 센 2보다 작게 두지 않는다
+    if (target_hodo_inode->type == HODO_TYPE_DIR)
+        set_nlink(vfs_inode, max_t(uint32_t, target_hodo_inode->i_nlink, 2));
+    else
+        set_nlink(vfs_inode, target_hodo_inode->i_nlink);
+    i_size_write(vfs_inode, target_hodo_inode->file_len);
 
-    vfs_inode->i_ino    = target_hodo_inode.i_ino;
-    vfs_inode->i_sb     = dir->i_sb;
-    vfs_inode->i_op     = &hodo_dir_inode_operations;
-    vfs_inode->i_fop    = &hodo_file_operations;
-    vfs_inode->i_mode   = target_hodo_inode.i_mode;
-    vfs_inode->i_uid    = target_hodo_inode.i_uid;
-    vfs_inode->i_gid    = target_hodo_inode.i_gid;
+    if (target_hodo_inode->type == HODO_TYPE_DIR) {
+        vfs_inode->i_op     = &hodo_dir_inode_operations;
+        vfs_inode->i_fop    = &hodo_dir_operations;
+    }
+    else if (target_hodo_inode->type == HODO_TYPE_LNK) {
+        vfs_inode->i_op     = &hodo_symlink_inode_operations;
+    }
+    else {
+        vfs_inode->i_op     = &hodo_file_inode_operations;
+        vfs_inode->i_fop    = &hodo_file_operations;
+        vfs_inode->i_mapping->a_ops = &hodo_file_aops;
+    }
 
-    inode_set_ctime_to_ts(vfs_inode, target_hodo_inode.i_ctime);
-    inode_set_mtime_to_ts(vfs_inode, target_hodo_inode.i_mtime);
-    inode_set_atime_to_ts(vfs_inode, target_hodo_inode.i_atime);
+    inode_set_ctime_to_ts(vfs_inode, target_hodo_inode->i_ctime);
+    inode_set_mtime_to_ts(vfs_inode, target_hodo_inode->i_mtime);
+    inode_set_atime_to_ts(vfs_inode, target_hodo_inode->i_atime);
+    hodo_free_block(target_hodo_inode);
+    unlock_new_inode(vfs_inode);
 
     //찾고자 했던 VFS 아이노드를 VFS 덴트리에 이어주자
-    d_add(dentry, vfs_inode);
-    return dentry;
+    return d_splice_alias(vfs_inode, dentry);
 }
 
 static int hodo_sub_readdir(struct file *file, struct dir_context *ctx) {
     // ZONEFS_TRACE();
 
+    hodo_stat_inc(HODO_STAT_READDIR);
+
     struct inode *inode = file_inode(file);
     struct dentry *dentry = file->f_path.dentry;
     const char *name = dentry->d_name.name;
 
-    struct timespec64 now;
-    now = current_time(inode);
-    inode_set_ctime_to_ts(inode, now);
-    inode_set_atime_to_ts(inode, now);
-    inode_set_mtime_to_ts(inode, now);
+    //atime은 iterate_dir이 file_accessed로 relatime, lazytime 규칙에 맞춰 고친다. 디렉토리를 읽기만 해서는 장치에 쓰지 않는다.
 
     //(inode->i_size 관리 규정이 확실해지면 기능 활성화하기)
     //ctx->pos는 지금까지 읽은 dirent('.', '..', 'hodo_dirent')의 개수를 나타낸다.
@@ -786,11 +1552,15 @@ static int hodo_sub_readdir(struct file *file, struct dir_context *ctx) {
 
     //디렉토리의 hodo 아이노드를 저장장치로부터 읽어온다
     logical_block_number_t dir_hodo_inode_logical_number = dir_hodo_mapping_index;
-    struct hodo_inode dir_hodo_inode = { 0, };
-    hodo_read_struct(dir_hodo_inode_logical_number, &dir_hodo_inode, sizeof(struct hodo_inode));
+    struct hodo_inode *dir_hodo_inode = hodo_alloc_block();
+    memset(dir_hodo_inode, 0, sizeof(struct hodo_inode));
+    hodo_read_inode(dir_hodo_inode_logical_number, dir_hodo_inode);
 
     //디렉토리 hodo 아이노드가 직간접적으로 가리키는 블럭 안의 덴트리들을 모조리 읽는다
-    return read_all_dirents(&dir_hodo_inode, ctx, &dirent_count);
+    int ret = read_all_dirents(dir_hodo_inode, ctx, &dirent_count);
+
+    hodo_free_block(dir_hodo_inode);
+    return ret;
 }
 
 static int hodo_sub_setattr(struct mnt_idmap *idmap, struct dentry *dentry, struct iattr *iattr) {
@@ -810,16 +1580,121 @@ static int hodo_sub_setattr(struct mnt_idmap *idmap, struct dentry *dentry, stru
 
 	if (iattr->ia_valid & ATTR_SIZE) {
         // pr_info("inode: %d\tia_size:%d\n", inode->i_ino, iattr->ia_size);
+        //일반 파일은 잘려 나간 블록들을 풀어주고 줄어든 extent tree와 아이노드를 다시 쓴 뒤에 페이지 캐시를 자른다
+        if (S_ISREG(inode->i_mode) && iattr->ia_size != i_size_read(inode)) {
+            struct hodo_inode *file_inode = hodo_alloc_block();
+
+            hodo_lock_inode(inode);
+            hodo_read_inode(inode->i_ino, file_inode);
+            ret = hodo_truncate_file(file_inode, iattr->ia_size);
+            hodo_unlock_inode(inode);
+            hodo_free_block(file_inode);
+            if (ret)
+                return ret;
+        }
 	    truncate_setsize(inode, iattr->ia_size);
-		// ret = zonefs_file_truncate(inode, iattr->ia_size);
-		// if (ret)
-		// 	return ret;
 	}
 
 	setattr_copy(&nop_mnt_idmap, inode, iattr);
+
+    //바뀐 모드, 소유자, 시각은 writeback이나 fsync가 .write_inode로 hodo 아이노드에 쓴다
+    mark_inode_dirty(inode);
 	return 0;
 }
 
+//이름 하나가 사라질 때 링크 수를 줄인다. 다른 이름이 남는 파일은 줄어든 i_nlink를 다시 써 두고,
+//마지막 이름이었다면 아이노드는 그대로 두었다가 마지막 iput(zonefs_evict_inode)에서 블록과 함께 풀어준다.
+static void hodo_sub_drop_link(struct inode *inode, struct timespec64 now) {
+    // ZONEFS_TRACE();
+
+    inode_set_ctime_to_ts(inode, now);
+
+    if (S_ISDIR(inode->i_mode)) {
+        clear_nlink(inode);
+        return;
+    }
+
+    if (inode->i_nlink > 1) {
+        struct hodo_inode *hodo_inode = hodo_alloc_block();
+
+        hodo_lock_inode(inode);
+        hodo_read_inode(inode->i_ino, hodo_inode);
+        hodo_inode->i_nlink--;
+        hodo_inode->i_ctime = now;
+        hodo_write_inode(hodo_inode);
+        hodo_unlock_inode(inode);
+        hodo_free_block(hodo_inode);
+    }
+    drop_nlink(inode);
+}
+
+//하위 디렉토리 하나가 빠져나간 디렉토리의 링크 수를 줄인다. 마운트 전부터 있던 하위 디렉토리를 세지 못한 루트처럼 수가 실제보다 적을 수 있으므로
+//2 밑으로는 내리지 않는다. 살아 있는 디렉토리의 i_nlink가 0이 되면 마지막 iput(zonefs_evict_inode)에서 블록이 모두 풀려 버린다.
+static void hodo_sub_drop_dir_nlink(struct inode *dir) {
+    if (dir->i_nlink > 2)
+        drop_nlink(dir);
+}
+
+//VFS 아이노드의 링크 수를 hodo 아이노드에 옮겨 쓴다. dirent를 고친 트랜잭션 안에서 부르면 같은 아이노드 블록과 함께 한 번만 쓰인다.
+static void hodo_sub_write_nlink(struct inode *inode) {
+    struct hodo_inode *hodo_inode = hodo_alloc_block();
+
+    hodo_lock_inode(inode);
+    hodo_read_inode(inode->i_ino, hodo_inode);
+    hodo_inode->i_nlink = inode->i_nlink;
+    hodo_write_inode(hodo_inode);
+    hodo_unlock_inode(inode);
+    hodo_free_block(hodo_inode);
+}
+
+//이름이 바뀐 아이노드에 새 이름과 ctime을 기록한다
+static void hodo_sub_write_name(struct inode *inode, const struct qstr *name, struct timespec64 now) {
+    struct hodo_inode *hodo_inode = hodo_alloc_block();
+
+    hodo_lock_inode(inode);
+    hodo_read_inode(inode->i_ino, hodo_inode);
+    hodo_inode->name_len = name->len;
+    memset(hodo_inode->name, 0, HODO_MAX_NAME_LEN);
+    memcpy(hodo_inode->name, name->name, name->len);
+    hodo_inode->i_ctime = now;
+    hodo_write_inode(hodo_inode);
+    hodo_unlock_inode(inode);
+    hodo_free_block(hodo_inode);
+}
+
+//디렉토리의 hodo 아이노드를 읽어 dirent 하나를 sub_inode를 가리키게 바꾼다. 같은 디렉토리를 잇달아 고쳐도 앞의 변경이 보이도록 매번 새로 읽는다.
+static void hodo_sub_replace_dirent(struct inode *dir, const char *name, struct hodo_inode *sub_inode) {
+    struct hodo_inode *dir_hodo_inode = hodo_alloc_block();
+
+    hodo_lock_inode(dir);
+    hodo_read_inode(dir->i_ino, dir_hodo_inode);
+    replace_dirent(dir_hodo_inode, dir, name, sub_inode);
+    hodo_unlock_inode(dir);
+    hodo_free_block(dir_hodo_inode);
+}
+
+//디렉토리의 hodo 아이노드를 읽어 dirent 하나를 지운다
+static void hodo_sub_remove_dirent(struct inode *dir, const char *name) {
+    struct hodo_inode *dir_hodo_inode = hodo_alloc_block();
+
+    hodo_lock_inode(dir);
+    hodo_read_inode(dir->i_ino, dir_hodo_inode);
+    remove_dirent(dir_hodo_inode, dir, name);
+    hodo_unlock_inode(dir);
+    hodo_free_block(dir_hodo_inode);
+}
+
+static ssize_t hodo_sub_file_read_iter(struct kiocb *iocb, struct iov_iter *to) {
+    // ZONEFS_TRACE();
+
+    //정렬된 O_DIRECT 읽기는 사용자 버퍼로 장치에서 바로 읽는다
+    if ((iocb->ki_flags & IOCB_DIRECT) && hodo_dio_aligned(iocb, to))
+        return hodo_sub_file_dio_read(iocb, to);
+
+    //그 외에는 페이지 캐시를 거친다. 순차 읽기 감지와 readahead는 VFS가 하고, 캐시에 없는 부분만 hodo_readahead/hodo_read_folio로 읽는다.
+    return generic_file_read_iter(iocb, to);
+}
+
 static ssize_t hodo_sub_file_write_iter(struct kiocb *iocb, struct iov_iter *from){
     // ZONEFS_TRACE();
     
@@ -827,11 +1702,20 @@ static ssize_t hodo_sub_file_write_iter(struct kiocb *iocb, struct iov_iter *fro
     ssize_t total_written_size = 0;
     ssize_t temp_written_size = 0;
 
+    //정렬된 O_DIRECT 쓰기는 사용자 버퍼를 바로 zone에 쓰고, 정렬되지 않은 요청만 블록 단위로 복사해서 쓴다
+    bool is_direct = (iocb->ki_flags & IOCB_DIRECT) && hodo_dio_aligned(iocb, from);
+
     while(total_written_size < len){
-        temp_written_size =  write_one_block(iocb, from);
+        if (is_direct)
+            temp_written_size = write_direct_blocks(iocb, from);
+        else
+            temp_written_size = write_one_block(iocb, from);
 
-        if(temp_written_size < 0)
-            return temp_written_size;
+        if(temp_written_size < 0) {
+            hodo_invalidate_written_range(iocb, total_written_size);
+            hodo_stat_add(HODO_STAT_HOST_BYTES_WRITTEN, total_written_size);
+            return total_written_size ? total_written_size : temp_written_size;
+        }
         else
             total_written_size += temp_written_size;
     }
@@ -839,6 +1723,53 @@ static ssize_t hodo_sub_file_write_iter(struct kiocb *iocb, struct iov_iter *fro
     // if (GC_timing()) {
     //     GC();
     // }
+
+    hodo_invalidate_written_range(iocb, total_written_size);
+    hodo_stat_add(HODO_STAT_HOST_BYTES_WRITTEN, total_written_size);
     
     return total_written_size;
+}
+
+//쓰기는 페이지 캐시를 거치지 않고 zone에 바로 가므로, 방금 쓴 범위에 캐시된 페이지가 있다면 버려서 다음 읽기가 새 내용을 읽게 한다
+static void hodo_invalidate_written_range(struct kiocb *iocb, ssize_t written_size) {
+    struct address_space *mapping = iocb->ki_filp->f_mapping;
+
+    if (written_size <= 0 || !mapping->nrpages)
+        return;
+
+    invalidate_inode_pages2_range(mapping, (iocb->ki_pos - written_size) >> PAGE_SHIFT, (iocb->ki_pos - 1) >> PAGE_SHIFT);
+}
+
+static ssize_t hodo_sub_file_dio_read(struct kiocb *iocb, struct iov_iter *to) {
+    // ZONEFS_TRACE();
+
+    struct inode *inode = file_inode(iocb->ki_filp);
+    ssize_t ret;
+
+    if (iocb->ki_flags & IOCB_NOWAIT) {
+        if (!inode_trylock_shared(inode))
+            return -EAGAIN;
+    } else {
+        inode_lock_shared(inode);
+    }
+
+    file_accessed(iocb->ki_filp);
+    ret = iomap_dio_rw(iocb, to, &hodo_read_iomap_ops, NULL, 0, NULL, 0);
+
+    inode_unlock_shared(inode);
+    return ret;
+}
+
+//파일 블록 단위로 정렬되고 사용자 버퍼가 장치 논리 블록 크기로 정렬된 요청만 direct I/O로 처리한다
+static bool hodo_dio_aligned(struct kiocb *iocb, struct iov_iter *iter) {
+    struct block_device *bdev = iocb->ki_filp->f_inode->i_sb->s_bdev;
+    loff_t pos = (iocb->ki_flags & IOCB_APPEND) ? i_size_read(iocb->ki_filp->f_inode) : iocb->ki_pos;
+
+    if ((pos | iov_iter_count(iter)) & (HODO_FILE_BLOCK_SIZE - 1))
+        return false;
+
+    if (iov_iter_alignment(iter) & (bdev_logical_block_size(bdev) - 1))
+        return false;
+
+    return true;
 }
\ No newline at end of file
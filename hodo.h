@@ -22,14 +22,30 @@
 
 #define HODO_TYPE_REG       0               // regular file(ex : a.txt)      
 #define HODO_TYPE_DIR       1               // directory file(ex : document)
+#define HODO_TYPE_LNK       2               // symbolic link(ex : latest -> a.txt)
 #define END_READ            0               // for read_dir
 #define NOTHING_FOUND       0               // for lookup, unlink
 #define EMPTY_CHECKED       1               // for rmdir
 #define NEW_DATABLOCK       0               // for write_struct
 
+#define HODO_INODE_INLINE_DIRENT        (1U << 0)       // dirent들을 데이터블록 대신 hodo_inode 안에 보관하는 작은 디렉토리
+#define HODO_INODE_INLINE_LINK          (1U << 1)       // symlink의 대상 경로를 hodo_inode 안에 보관한다
+#define HODO_INLINE_DIRENT_COUNT        96              // hodo_inode 하나에 들어가는 inline dirent의 개수
+
+#define HODO_INODE_CORE_SIZE            256 * B                         // inline 영역을 제외한 hodo_inode 앞부분의 크기
+#define HODO_INODES_PER_BLOCK           15                              // inode block 하나에 들어가는 아이노드 slot의 개수
+
+#define HODO_INODE_EXTENT_COUNT         12                              // hodo_inode 안에 들어가는 extent(또는 extent index)의 개수
+#define HODO_LEAF_EXTENT_COUNT          340                             // extent leaf block 하나에 들어가는 extent의 개수
+#define HODO_MAX_FILE_BLOCKS            0xFFFFFFFFU                     // extent의 e_block으로 표현 가능한 파일 블록 수
+#define HODO_LEAF_CACHE_SIZE            16                              // 메모리에 들고 있는 extent leaf block의 개수
+#define HODO_BLOCK_POOL_RESERVE         8                               // 메모리가 부족할 때를 위해 CPU마다 미리 잡아 두는 임시 블록 수
+#define HODO_TRANS_MAX_BLOCKS           64                              // 메타데이터 트랜잭션 하나에 모아 두었다가 한 번에 쓰는 블록 수의 상한
+
 #define HODO_DATABLOCK_SIZE             4096 * B       
 #define HODO_DATA_START                 8 * B
 #define HODO_DATA_SIZE                  (HODO_DATABLOCK_SIZE - HODO_DATA_START)
+#define HODO_FILE_BLOCK_SIZE            HODO_DATABLOCK_SIZE             // 일반 파일의 데이터블록은 헤더 없이 블록 전체가 데이터이다
 
 #define NUMBER_ZONES                    16                              // 16 zones
 #define ZONE_SIZE                       (256ULL * MB)                   // 256MB per each zone
@@ -37,6 +53,7 @@
 #define SSD_CAPACITY                    (NUMBER_ZONES * ZONE_SIZE)              // total 4GB ZNS SSD
 #define NUMBER_MAPPING_TABLE_ENTRY      (SSD_CAPACITY / HODO_DATABLOCK_SIZE)    // number of 2^20 entries
 #define BLOCKS_PER_ZONE                 (ZONE_SIZE / HODO_DATABLOCK_SIZE)       // 
+#define HODO_GC_INVALID_THRESHOLD       (BLOCKS_PER_ZONE / 2)                   // victim zone의 무효 블록이 이만큼 쌓이면 GC한다
 
 typedef unsigned int                    logical_block_number_t;
 #define BLOCK_PTR_SZ                    sizeof(logical_block_number_t)
@@ -54,12 +71,30 @@ struct hodo_block_pos {
     uint16_t block_index;
 };
 
+//디렉토리의 dirent 블록과 indirect 블록 형식. 일반 파일의 데이터블록은 이 헤더 없이 HODO_FILE_BLOCK_SIZE 전체를 쓴다.
 struct hodo_datablock {
     char magic[4];
     logical_block_number_t logical_block_number;
     char data[HODO_DATA_SIZE];
 };
 
+//파일의 e_block번째 데이터블록부터 e_len개의 데이터블록이 논리 번호 e_start부터 연속으로 놓여 있다
+//extent index로 쓰일 때는 e_block부터 시작하는 파일 블록들을 e_start(extent leaf block의 논리 번호)가 담당한다
+struct hodo_extent {
+    uint32_t e_block;
+    uint32_t e_len;
+    logical_block_number_t e_start;
+};
+
+//hodo_inode 안의 extent가 모자랄 때 extent들을 옮겨 담는 블록
+struct hodo_extent_leaf {
+    char magic[4];                                                  // "EXT0"
+    logical_block_number_t logical_block_number;
+    uint32_t count;
+    struct hodo_extent extent[HODO_LEAF_EXTENT_COUNT];
+    char padding[4];
+};
+
 struct hodo_dirent {
     char name[HODO_MAX_NAME_LEN];
     uint8_t name_len;
@@ -69,6 +104,7 @@ struct hodo_dirent {
 
 struct hodo_inode {
     char magic[4];
+    uint32_t i_flags;
     uint64_t file_len;
 
     uint8_t  name_len;
@@ -85,28 +121,134 @@ struct hodo_inode {
     struct timespec64 i_mtime;
     struct timespec64 i_ctime;
 
-    logical_block_number_t direct[10];
-    logical_block_number_t single_indirect;
-    logical_block_number_t double_indirect;
-    logical_block_number_t triple_indirect;
+    union {
+        //디렉토리(HODO_TYPE_DIR)의 dirent 블록들
+        struct {
+            logical_block_number_t direct[10];
+            logical_block_number_t single_indirect;
+            logical_block_number_t double_indirect;
+            logical_block_number_t triple_indirect;
+        };
+        //일반 파일(HODO_TYPE_REG)의 extent tree. depth가 0이면 i_extent가 extent이고, 1이면 extent leaf block을 가리키는 index이다.
+        struct {
+            uint16_t i_extent_count;
+            uint16_t i_extent_depth;
+            struct hodo_extent i_extent[HODO_INODE_EXTENT_COUNT];
+        };
+    };
+
+    char core_padding[4];
+
+    //여기부터는 inline 영역이다. inline 영역을 쓰지 않는 아이노드는 앞의 HODO_INODE_CORE_SIZE만큼만 inode block에 저장된다.
+    union {
+        struct hodo_dirent inline_dirent[HODO_INLINE_DIRENT_COUNT];    // HODO_INODE_INLINE_DIRENT일 때만 사용
+        char i_link[HODO_INLINE_DIRENT_COUNT * sizeof(struct hodo_dirent)];     // HODO_INODE_INLINE_LINK일 때만 사용. '\0'으로 끝난다.
+    };
+};
 
-    char padding[3936];
+//inline 영역을 쓰지 않는 아이노드 여러 개를 한 블록에 모아 저장하는 형식
+struct hodo_inode_block {
+    char magic[4];                                                  // "INOB"
+    logical_block_number_t logical_block_number;
+    logical_block_number_t slot_ino[HODO_INODES_PER_BLOCK];        // 각 slot을 마지막으로 쓴 아이노드 번호
+    char padding[188];
+    char slot[HODO_INODES_PER_BLOCK][HODO_INODE_CORE_SIZE];
 };
 
 struct hodo_mapping_info {
     struct hodo_block_pos mapping_table[NUMBER_MAPPING_TABLE_ENTRY];
     logical_block_number_t starting_logical_number;
     struct hodo_block_pos wp;
-    uint32_t logical_entry_bitmap[NUMBER_MAPPING_TABLE_ENTRY / 32];
+    unsigned long logical_entry_bitmap[BITS_TO_LONGS(NUMBER_MAPPING_TABLE_ENTRY)];   // 커널 bitop 순서의 논리 번호 사용 여부
 
     uint32_t invalid_count;
     uint32_t valid_count;
     uint32_t GC_bitmap[NUMBER_ZONES][BLOCKS_PER_ZONE / 32];
     struct hodo_block_pos swap_wp;
+
+    //아이노드 번호 -> (그 아이노드가 들어있는 inode block의 논리 번호, slot 번호)
+    //inode block 논리 번호가 0이면 블록 하나를 통째로 쓰는 아이노드이며, 아이노드 번호 자체가 매핑 테이블에 올라간다.
+    logical_block_number_t inode_block_table[NUMBER_MAPPING_TABLE_ENTRY];
+    uint8_t inode_slot_table[NUMBER_MAPPING_TABLE_ENTRY];
+    logical_block_number_t current_inode_block;                     // 새 아이노드를 채워 넣고 있는 inode block
+
+    //(zone, block index) -> 그 위치에 마지막으로 쓰인 논리 번호. GC는 블록 내용 대신 이 표로 옮길 블록의 논리 번호를 알아낸다.
+    logical_block_number_t zone_summary[NUMBER_ZONES][BLOCKS_PER_ZONE];
+
+    //논리 번호 -> 그 블록을 함께 가리키는 다른 파일의 수. reflink로 나눠 쓰는 블록만 0이 아니며, 0이 아닌 블록은 고쳐 쓰지 않고 복사해서 쓴다.
+    uint16_t share_count[NUMBER_MAPPING_TABLE_ENTRY];
 };
 
+//CPU마다 따로 세는 hodo 성능 카운터. /sys/fs/zonefs/<dev>/hodo/ 아래에서 모든 CPU의 합을 보여준다.
+enum hodo_stat_item {
+    HODO_STAT_HOST_BYTES_WRITTEN,                                   // 사용자가 파일에 쓴 바이트
+    HODO_STAT_DEVICE_BYTES_WRITTEN,                                 // 메타데이터와 GC를 포함해 장치에 쓴 바이트
+    HODO_STAT_GC_CYCLES,
+    HODO_STAT_GC_MIGRATED_BLOCKS,
+    HODO_STAT_ZONE_RESETS,
+    HODO_STAT_LOOKUP,
+    HODO_STAT_CREATE,
+    HODO_STAT_UNLINK,
+    HODO_STAT_READDIR,
+    HODO_STAT_LEAF_CACHE_HIT,                                       // extent leaf를 장치에서 읽지 않고 cache에서 찾은 횟수
+    HODO_STAT_LEAF_CACHE_MISS,
+    HODO_STAT_TRANS_COMMITS,                                        // 메타데이터 트랜잭션을 장치에 쓴 횟수
+    HODO_STAT_TRANS_BLOCKS,                                         // 트랜잭션 커밋으로 쓴 블록 수
+    HODO_STAT_NR,
+};
+
+struct hodo_stats {
+    u64 count[HODO_STAT_NR];
+};
+
+DECLARE_PER_CPU(struct hodo_stats, hodo_stats);
+
+#define hodo_stat_add(item, n)          this_cpu_add(hodo_stats.count[item], n)
+#define hodo_stat_inc(item)             hodo_stat_add(item, 1)
+
+//연산별 latency 히스토그램. bucket[i]에는 [2^i, 2^(i+1)) ns 걸린 호출 수가 쌓이고, 마지막 bucket은 그보다 오래 걸린 호출까지 받는다.
+//debugfs의 zonefs/hodo_latency에서 읽고, 그 파일에 아무 값이나 쓰면 0으로 돌아간다.
+#define HODO_LAT_BUCKETS                32
+
+enum hodo_lat_item {
+    HODO_LAT_CREATE,
+    HODO_LAT_UNLINK,
+    HODO_LAT_MKDIR,
+    HODO_LAT_LOOKUP,
+    HODO_LAT_READDIR,
+    HODO_LAT_READ_ITER,
+    HODO_LAT_WRITE_ITER,
+    HODO_LAT_DEVICE_READ,                                           // seq zone 파일에서 블록을 읽는 시간
+    HODO_LAT_DEVICE_WRITE,                                          // seq zone 파일에 블록(들)을 쓰는 시간
+    HODO_LAT_GC,                                                    // GC 한 번 전체
+    HODO_LAT_NR,
+};
+
+struct hodo_latency {
+    u64 bucket[HODO_LAT_NR][HODO_LAT_BUCKETS];
+};
+
+DECLARE_PER_CPU(struct hodo_latency, hodo_latency);
+
+static inline void hodo_latency_record(enum hodo_lat_item item, u64 start_ns) {
+    u64 delta = ktime_get_ns() - start_ns;
+    int bucket = delta ? min_t(int, ilog2(delta), HODO_LAT_BUCKETS - 1) : 0;
+
+    this_cpu_inc(hodo_latency.bucket[item][bucket]);
+}
+
 extern char mount_point_path[16];
 extern struct hodo_mapping_info mapping_info;
 
+u64 hodo_stat_read(enum hodo_stat_item item);
+
 void hodo_init(void);
+
+int hodo_block_pool_init(void);
+void hodo_block_pool_exit(void);
+void *hodo_alloc_block(void);
+void hodo_free_block(void *block);
+
+void hodo_debugfs_init(void);
+void hodo_debugfs_exit(void);
 #endif
\ No newline at end of file
@@ -30,6 +30,7 @@
 #include <linux/delay.h>
 #include "zonefs.h"
 #include "hodo.h"
+#include "trans.h"
 
 #define CREATE_TRACE_POINTS
 #include "trace.h"
@@ -439,6 +440,7 @@ static struct inode *zonefs_alloc_inode(struct super_block *sb)
         inode_init_once(&zi->i_vnode);
         mutex_init(&zi->i_truncate_mutex);
         zi->i_wr_refcnt = 0;
+        mutex_init(&zi->i_hodo_mutex);
 
         return &zi->i_vnode;
 }
@@ -478,6 +480,12 @@ static int zonefs_statfs(struct dentry *dentry, struct kstatfs *buf)
 
         spin_unlock(&sbi->s_lock);
 
+        /*
+         * Once hodo owns the sequential zones, report its log usage
+         * instead of the per-zone file view.
+         */
+        hodo_fill_statfs(buf);
+
         buf->f_fsid = uuid_to_fsid(sbi->s_uuid.b);
 
         return 0;
@@ -1222,9 +1230,40 @@ free_page:
         return ret;
 }
 
+/*
+ * The last reference to a hodo inode with no links left is gone: release
+ * every block the inode references, then the inode itself.
+ */
+static void zonefs_evict_inode(struct inode *inode)
+{
+        truncate_inode_pages_final(&inode->i_data);
+
+        if (!inode->i_nlink &&
+            inode->i_ino >= mapping_info.starting_logical_number)
+                hodo_evict_inode(inode->i_ino);
+
+        clear_inode(inode);
+}
+
+/*
+ * Write the attributes of a dirty hodo inode to its on-disk hodo inode.
+ * Zone files and the zone group directories keep nothing on disk.
+ */
+static int zonefs_write_inode(struct inode *inode,
+                              struct writeback_control *wbc)
+{
+        if (inode->i_ino < mapping_info.starting_logical_number ||
+            inode->i_private)
+                return 0;
+
+        return hodo_sync_inode(inode);
+}
+
 static const struct super_operations zonefs_sops = {
         .alloc_inode    = zonefs_alloc_inode,
         .free_inode     = zonefs_free_inode,
+        .write_inode    = zonefs_write_inode,
+        .evict_inode    = zonefs_evict_inode,
         .statfs         = zonefs_statfs,
         .remount_fs     = zonefs_remount,
         .show_options   = zonefs_show_options,
@@ -1406,6 +1445,16 @@ static void zonefs_kill_super(struct super_block *sb)
 {
         struct zonefs_sb_info *sbi = ZONEFS_SB(sb);
 
+        /*
+         * The mount is already detached here, so blocks left staged by a
+         * failed commit cannot be written anymore: drop them rather than
+         * leaking them into the next mount.
+         */
+        hodo_trans_discard();
+
+        /* Return the logical numbers still cached in the per-CPU batches */
+        hodo_drain_logical_batches();
+
         /* Release the reference on the zone group directory inodes */
         zonefs_release_zgroup_inodes(sb);
 
@@ -1453,23 +1502,36 @@ static int __init zonefs_init(void)
         int ret;
 
         BUILD_BUG_ON(sizeof(struct zonefs_super) != ZONEFS_SUPER_SIZE);
+        BUILD_BUG_ON(sizeof(struct hodo_inode) != HODO_DATABLOCK_SIZE);
+        BUILD_BUG_ON(offsetof(struct hodo_inode, inline_dirent) != HODO_INODE_CORE_SIZE);
+        BUILD_BUG_ON(sizeof(struct hodo_inode_block) != HODO_DATABLOCK_SIZE);
+        BUILD_BUG_ON(sizeof(struct hodo_extent_leaf) != HODO_DATABLOCK_SIZE);
 
         ret = zonefs_init_inodecache();
         if (ret)
                 return ret;
 
-        ret = zonefs_sysfs_init();
+        ret = hodo_block_pool_init();
         if (ret)
                 goto destroy_inodecache;
 
+        ret = zonefs_sysfs_init();
+        if (ret)
+                goto destroy_block_pool;
+
+        hodo_debugfs_init();
+
         ret = register_filesystem(&zonefs_type);
         if (ret)
-                goto sysfs_exit;
+                goto debugfs_exit;
 
         return 0;
 
-sysfs_exit:
+debugfs_exit:
+        hodo_debugfs_exit();
         zonefs_sysfs_exit();
+destroy_block_pool:
+        hodo_block_pool_exit();
 destroy_inodecache:
         zonefs_destroy_inodecache();
 
@@ -1479,7 +1541,9 @@ destroy_inodecache:
 static void __exit zonefs_exit(void)
 {
         unregister_filesystem(&zonefs_type);
+        hodo_debugfs_exit();
         zonefs_sysfs_exit();
+        hodo_block_pool_exit();
         zonefs_destroy_inodecache();
 }
 
@@ -14,6 +14,8 @@
 #include <linux/blkdev.h>
 
 #include "zonefs.h"
+#include "hodo.h"
+#include "trans.h"
 
 struct zonefs_sysfs_attr {
 	struct attribute attr;
@@ -90,6 +92,126 @@ static const struct kobj_type zonefs_sb_ktype = {
 	.release	= zonefs_sysfs_sb_release,
 };
 
+/*
+ * hodo attributes, exported in the "hodo" sub-directory of the device
+ * directory. Event counters are per-CPU and summed when read.
+ */
+static ssize_t hodo_sysfs_attr_show(struct kobject *kobj,
+				    struct attribute *attr, char *buf)
+{
+	struct zonefs_sb_info *sbi =
+		container_of(kobj, struct zonefs_sb_info, s_hodo_kobj);
+	struct zonefs_sysfs_attr *zonefs_attr =
+		container_of(attr, struct zonefs_sysfs_attr, attr);
+
+	if (!zonefs_attr->show)
+		return 0;
+
+	return zonefs_attr->show(sbi, buf);
+}
+
+#define HODO_SYSFS_STAT_RO(name, item)					\
+static ssize_t name##_show(struct zonefs_sb_info *sbi, char *buf)	\
+{									\
+	return sysfs_emit(buf, "%llu\n", hodo_stat_read(item));	\
+}									\
+ZONEFS_SYSFS_ATTR_RO(name)
+
+HODO_SYSFS_STAT_RO(host_bytes_written, HODO_STAT_HOST_BYTES_WRITTEN);
+HODO_SYSFS_STAT_RO(device_bytes_written, HODO_STAT_DEVICE_BYTES_WRITTEN);
+HODO_SYSFS_STAT_RO(gc_cycles, HODO_STAT_GC_CYCLES);
+HODO_SYSFS_STAT_RO(gc_migrated_blocks, HODO_STAT_GC_MIGRATED_BLOCKS);
+HODO_SYSFS_STAT_RO(zone_resets, HODO_STAT_ZONE_RESETS);
+HODO_SYSFS_STAT_RO(lookups, HODO_STAT_LOOKUP);
+HODO_SYSFS_STAT_RO(creates, HODO_STAT_CREATE);
+HODO_SYSFS_STAT_RO(unlinks, HODO_STAT_UNLINK);
+HODO_SYSFS_STAT_RO(readdirs, HODO_STAT_READDIR);
+HODO_SYSFS_STAT_RO(leaf_cache_hits, HODO_STAT_LEAF_CACHE_HIT);
+HODO_SYSFS_STAT_RO(leaf_cache_misses, HODO_STAT_LEAF_CACHE_MISS);
+HODO_SYSFS_STAT_RO(trans_commits, HODO_STAT_TRANS_COMMITS);
+HODO_SYSFS_STAT_RO(trans_blocks, HODO_STAT_TRANS_BLOCKS);
+
+/* Device bytes per host byte, with two decimals */
+static ssize_t write_amplification_show(struct zonefs_sb_info *sbi, char *buf)
+{
+	u64 host = hodo_stat_read(HODO_STAT_HOST_BYTES_WRITTEN);
+	u64 device = hodo_stat_read(HODO_STAT_DEVICE_BYTES_WRITTEN);
+	u64 waf;
+
+	if (!host)
+		return sysfs_emit(buf, "0.00\n");
+
+	waf = div64_u64(device * 100, host);
+	return sysfs_emit(buf, "%llu.%02llu\n", waf / 100, waf % 100);
+}
+ZONEFS_SYSFS_ATTR_RO(write_amplification);
+
+static ssize_t wp_show(struct zonefs_sb_info *sbi, char *buf)
+{
+	return sysfs_emit(buf, "%u %u\n", mapping_info.wp.zone_id,
+			  mapping_info.wp.block_index);
+}
+ZONEFS_SYSFS_ATTR_RO(wp);
+
+static ssize_t free_zones_show(struct zonefs_sb_info *sbi, char *buf)
+{
+	return sysfs_emit(buf, "%u\n", hodo_get_free_zone_count());
+}
+ZONEFS_SYSFS_ATTR_RO(free_zones);
+
+static ssize_t valid_blocks_show(struct zonefs_sb_info *sbi, char *buf)
+{
+	return sysfs_emit(buf, "%u\n", mapping_info.valid_count);
+}
+ZONEFS_SYSFS_ATTR_RO(valid_blocks);
+
+static ssize_t invalid_blocks_show(struct zonefs_sb_info *sbi, char *buf)
+{
+	return sysfs_emit(buf, "%u\n", mapping_info.invalid_count);
+}
+ZONEFS_SYSFS_ATTR_RO(invalid_blocks);
+
+static struct attribute *hodo_sysfs_attrs[] = {
+	ATTR_LIST(host_bytes_written),
+	ATTR_LIST(device_bytes_written),
+	ATTR_LIST(write_amplification),
+	ATTR_LIST(gc_cycles),
+	ATTR_LIST(gc_migrated_blocks),
+	ATTR_LIST(zone_resets),
+	ATTR_LIST(wp),
+	ATTR_LIST(free_zones),
+	ATTR_LIST(valid_blocks),
+	ATTR_LIST(invalid_blocks),
+	ATTR_LIST(lookups),
+	ATTR_LIST(creates),
+	ATTR_LIST(unlinks),
+	ATTR_LIST(readdirs),
+	ATTR_LIST(leaf_cache_hits),
+	ATTR_LIST(leaf_cache_misses),
+	ATTR_LIST(trans_commits),
+	ATTR_LIST(trans_blocks),
+	NULL,
+};
+ATTRIBUTE_GROUPS(hodo_sysfs);
+
+static void hodo_sysfs_release(struct kobject *kobj)
+{
+	struct zonefs_sb_info *sbi =
+		container_of(kobj, struct zonefs_sb_info, s_hodo_kobj);
+
+	complete(&sbi->s_hodo_kobj_unregister);
+}
+
+static const struct sysfs_ops hodo_sysfs_attr_ops = {
+	.show	= hodo_sysfs_attr_show,
+};
+
+static const struct kobj_type hodo_ktype = {
+	.default_groups = hodo_sysfs_groups,
+	.sysfs_ops	= &hodo_sysfs_attr_ops,
+	.release	= hodo_sysfs_release,
+};
+
 static struct kobject *zonefs_sysfs_root;
 
 int zonefs_sysfs_register(struct super_block *sb)
@@ -106,6 +228,18 @@ int zonefs_sysfs_register(struct super_block *sb)
 		return ret;
 	}
 
+	init_completion(&sbi->s_hodo_kobj_unregister);
+	ret = kobject_init_and_add(&sbi->s_hodo_kobj, &hodo_ktype,
+				   &sbi->s_kobj, "hodo");
+	if (ret) {
+		kobject_put(&sbi->s_hodo_kobj);
+		wait_for_completion(&sbi->s_hodo_kobj_unregister);
+		kobject_del(&sbi->s_kobj);
+		kobject_put(&sbi->s_kobj);
+		wait_for_completion(&sbi->s_kobj_unregister);
+		return ret;
+	}
+
 	sbi->s_sysfs_registered = true;
 
 	return 0;
@@ -118,6 +252,10 @@ void zonefs_sysfs_unregister(struct super_block *sb)
 	if (!sbi || !sbi->s_sysfs_registered)
 		return;
 
+	kobject_del(&sbi->s_hodo_kobj);
+	kobject_put(&sbi->s_hodo_kobj);
+	wait_for_completion(&sbi->s_hodo_kobj_unregister);
+
 	kobject_del(&sbi->s_kobj);
 	kobject_put(&sbi->s_kobj);
 	wait_for_completion(&sbi->s_kobj_unregister);
@@ -20,6 +20,7 @@
 #include <linux/blkdev.h>
 
 #include "zonefs.h"
+#include "hodo.h"
 
 #define show_dev(dev) MAJOR(dev), MINOR(dev)
 
@@ -99,6 +100,175 @@ TRACE_EVENT(zonefs_iomap_begin,
 	    )
 );
 
+DECLARE_EVENT_CLASS(hodo_block_io,
+	    TP_PROTO(logical_block_number_t lbn, struct hodo_block_pos pos,
+		     size_t len, ssize_t ret, u64 latency_ns),
+	    TP_ARGS(lbn, pos, len, ret, latency_ns),
+	    TP_STRUCT__entry(
+			     __field(logical_block_number_t, lbn)
+			     __field(u16, zone_id)
+			     __field(u16, block_index)
+			     __field(size_t, len)
+			     __field(ssize_t, ret)
+			     __field(u64, latency_ns)
+	    ),
+	    TP_fast_assign(
+			   __entry->lbn = lbn;
+			   __entry->zone_id = pos.zone_id;
+			   __entry->block_index = pos.block_index;
+			   __entry->len = len;
+			   __entry->ret = ret;
+			   __entry->latency_ns = latency_ns;
+	    ),
+	    TP_printk("lbn=%u, zone=%u, block=%u, len=%zu, ret=%zd, latency_ns=%llu",
+		      __entry->lbn, __entry->zone_id, __entry->block_index,
+		      __entry->len, __entry->ret, __entry->latency_ns
+	    )
+);
+
+DEFINE_EVENT(hodo_block_io, hodo_read_struct,
+	    TP_PROTO(logical_block_number_t lbn, struct hodo_block_pos pos,
+		     size_t len, ssize_t ret, u64 latency_ns),
+	    TP_ARGS(lbn, pos, len, ret, latency_ns)
+);
+
+DEFINE_EVENT(hodo_block_io, hodo_write_struct,
+	    TP_PROTO(logical_block_number_t lbn, struct hodo_block_pos pos,
+		     size_t len, ssize_t ret, u64 latency_ns),
+	    TP_ARGS(lbn, pos, len, ret, latency_ns)
+);
+
+TRACE_EVENT(hodo_remap,
+	    TP_PROTO(logical_block_number_t lbn, struct hodo_block_pos old_pos,
+		     struct hodo_block_pos new_pos),
+	    TP_ARGS(lbn, old_pos, new_pos),
+	    TP_STRUCT__entry(
+			     __field(logical_block_number_t, lbn)
+			     __field(u16, old_zone)
+			     __field(u16, old_block)
+			     __field(u16, new_zone)
+			     __field(u16, new_block)
+	    ),
+	    TP_fast_assign(
+			   __entry->lbn = lbn;
+			   __entry->old_zone = old_pos.zone_id;
+			   __entry->old_block = old_pos.block_index;
+			   __entry->new_zone = new_pos.zone_id;
+			   __entry->new_block = new_pos.block_index;
+	    ),
+	    TP_printk("lbn=%u, old=(%u,%u), new=(%u,%u)",
+		      __entry->lbn, __entry->old_zone, __entry->old_block,
+		      __entry->new_zone, __entry->new_block
+	    )
+);
+
+TRACE_EVENT(hodo_trans_commit,
+	    TP_PROTO(struct hodo_block_pos pos, u32 nr_blocks, ssize_t ret,
+		     u64 latency_ns),
+	    TP_ARGS(pos, nr_blocks, ret, latency_ns),
+	    TP_STRUCT__entry(
+			     __field(u16, zone_id)
+			     __field(u16, block_index)
+			     __field(u32, nr_blocks)
+			     __field(ssize_t, ret)
+			     __field(u64, latency_ns)
+	    ),
+	    TP_fast_assign(
+			   __entry->zone_id = pos.zone_id;
+			   __entry->block_index = pos.block_index;
+			   __entry->nr_blocks = nr_blocks;
+			   __entry->ret = ret;
+			   __entry->latency_ns = latency_ns;
+	    ),
+	    TP_printk("zone=%u, block=%u, nr_blocks=%u, ret=%zd, latency_ns=%llu",
+		      __entry->zone_id, __entry->block_index,
+		      __entry->nr_blocks, __entry->ret, __entry->latency_ns
+	    )
+);
+
+TRACE_EVENT(hodo_gc_begin,
+	    TP_PROTO(int victim, u32 victim_valid, u32 victim_invalid,
+		     u32 total_invalid, struct hodo_block_pos wp),
+	    TP_ARGS(victim, victim_valid, victim_invalid, total_invalid, wp),
+	    TP_STRUCT__entry(
+			     __field(int, victim)
+			     __field(u32, victim_valid)
+			     __field(u32, victim_invalid)
+			     __field(u32, total_invalid)
+			     __field(u16, wp_zone)
+			     __field(u16, wp_block)
+	    ),
+	    TP_fast_assign(
+			   __entry->victim = victim;
+			   __entry->victim_valid = victim_valid;
+			   __entry->victim_invalid = victim_invalid;
+			   __entry->total_invalid = total_invalid;
+			   __entry->wp_zone = wp.zone_id;
+			   __entry->wp_block = wp.block_index;
+	    ),
+	    TP_printk("victim=%d, victim_valid=%u, victim_invalid=%u, total_invalid=%u, wp=(%u,%u)",
+		      __entry->victim, __entry->victim_valid,
+		      __entry->victim_invalid, __entry->total_invalid,
+		      __entry->wp_zone, __entry->wp_block
+	    )
+);
+
+TRACE_EVENT(hodo_gc_zone_migrated,
+	    TP_PROTO(int zone_id, u32 nr_blocks),
+	    TP_ARGS(zone_id, nr_blocks),
+	    TP_STRUCT__entry(
+			     __field(int, zone_id)
+			     __field(u32, nr_blocks)
+	    ),
+	    TP_fast_assign(
+			   __entry->zone_id = zone_id;
+			   __entry->nr_blocks = nr_blocks;
+	    ),
+	    TP_printk("zone=%d, migrated=%u",
+		      __entry->zone_id, __entry->nr_blocks
+	    )
+);
+
+TRACE_EVENT(hodo_gc_end,
+	    TP_PROTO(u32 nr_migrated, struct hodo_block_pos wp, u64 latency_ns),
+	    TP_ARGS(nr_migrated, wp, latency_ns),
+	    TP_STRUCT__entry(
+			     __field(u32, nr_migrated)
+			     __field(u16, wp_zone)
+			     __field(u16, wp_block)
+			     __field(u64, latency_ns)
+	    ),
+	    TP_fast_assign(
+			   __entry->nr_migrated = nr_migrated;
+			   __entry->wp_zone = wp.zone_id;
+			   __entry->wp_block = wp.block_index;
+			   __entry->latency_ns = latency_ns;
+	    ),
+	    TP_printk("migrated=%u, wp=(%u,%u), latency_ns=%llu",
+		      __entry->nr_migrated, __entry->wp_zone,
+		      __entry->wp_block, __entry->latency_ns
+	    )
+);
+
+TRACE_EVENT(hodo_wp_switch,
+	    TP_PROTO(int old_zone, int new_zone, u32 old_zone_valid),
+	    TP_ARGS(old_zone, new_zone, old_zone_valid),
+	    TP_STRUCT__entry(
+			     __field(int, old_zone)
+			     __field(int, new_zone)
+			     __field(u32, old_zone_valid)
+	    ),
+	    TP_fast_assign(
+			   __entry->old_zone = old_zone;
+			   __entry->new_zone = new_zone;
+			   __entry->old_zone_valid = old_zone_valid;
+	    ),
+	    TP_printk("old_zone=%d, new_zone=%d, old_zone_valid=%u",
+		      __entry->old_zone, __entry->new_zone,
+		      __entry->old_zone_valid
+	    )
+);
+
 #endif /* _TRACE_ZONEFS_H */
 
 #undef TRACE_INCLUDE_PATH
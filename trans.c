@@ -9,66 +9,182 @@
  * Copyright (C) 2025 StayInTheKitchen, Antler9000
  */
 
+#include <linux/bitmap.h>
 #include <linux/blkdev.h>
+#include <linux/ktime.h>
+#include <linux/mutex.h>
 #include <linux/namei.h>
+#include <linux/percpu.h>
+#include <linux/spinlock.h>
+#include <linux/statfs.h>
 
 #include "zonefs.h"
 #include "hodo.h"
 #include "trans.h"
-
-int zone_1_valid_count = 0;
-int zone_2_valid_count = 0;
-
-int zone_1_valid_set_count = 0;
-int zone_2_valid_set_count = 0;
-
-int zone_1_valid_unset_count = 0;
-int zone_2_valid_unset_count = 0;
+#include "trace.h"
+
+//zone마다 살아있는 블록 수를 GC_bitmap이 바뀔 때마다 함께 고친다. 다 쓴 zone들은 살아있는 블록 수로 정렬된 min-heap에 들어 있어서
+//GC가 옮길 블록이 가장 적은 zone을 바로 고를 수 있다. 아직 다 쓰지 않은 zone(wp가 있거나 그 뒤의 zone)은 heap의 맨 뒤로 밀린다.
+static uint32_t hodo_zone_valid_count[NUMBER_ZONES];
+static int hodo_victim_heap[NUMBER_ZONES];
+static int hodo_victim_heap_index[NUMBER_ZONES];               // zone이 heap의 몇 번째에 있는지. heap에 없으면 -1
+static int hodo_victim_heap_size;
+
+//GC_bitmap, zone별/전체 유효·무효 블록 수, victim heap은 쓰기 경로, 트랜잭션 커밋, 블록 해제, GC가 함께 고치므로 이 lock으로 지킨다.
+//hodo_wp_lock을 함께 잡을 때는 hodo_wp_lock을 먼저 잡는다.
+static DEFINE_SPINLOCK(hodo_zone_stats_lock);
+
+//최근에 읽거나 쓴 extent leaf block들. leaf의 논리 번호를 HODO_LEAF_CACHE_SIZE로 나눈 나머지 slot에 들어간다.
+//leaf는 항상 같은 논리 번호에 다시 쓰이고 GC도 논리 번호를 바꾸지 않으므로, leaf를 쓸 때 slot도 함께 고치기만 하면 장치와 어긋나지 않는다.
+static struct hodo_extent_leaf hodo_leaf_cache[HODO_LEAF_CACHE_SIZE];
+static logical_block_number_t hodo_leaf_cache_tag[HODO_LEAF_CACHE_SIZE];     // slot에 든 leaf의 논리 번호. 0이면 빈 slot
+static DEFINE_MUTEX(hodo_leaf_cache_lock);
+
+//create, unlink 같은 메타데이터 연산이 쓰는 아이노드 블록과 디렉토리 블록들을 메모리에 모아 두었다가 한 번의 append로 쓴다.
+//동시에 열린 연산들은 같은 트랜잭션에 모이고, 마지막으로 끝나는 연산이 모두의 블록을 함께 커밋한다(group commit).
+struct hodo_trans {
+    struct mutex lock;
+    int users;                                                      // 트랜잭션 안에 있는 연산의 수
+    struct list_head handles;                                       // 열린 연산들의 hodo_trans_handle. 쓰는 태스크가 트랜잭션 안인지 여기서 찾는다
+    int count;                                                      // 모아 둔 블록의 수
+    logical_block_number_t logical_block_number[HODO_TRANS_MAX_BLOCKS];
+    void *block[HODO_TRANS_MAX_BLOCKS];
+    struct kvec kvec[HODO_TRANS_MAX_BLOCKS];                        // 커밋할 때 블록들을 write 한 번으로 묶는 데 쓴다
+};
+
+static struct hodo_trans hodo_trans = {
+    .lock = __MUTEX_INITIALIZER(hodo_trans.lock),
+    .handles = LIST_HEAD_INIT(hodo_trans.handles),
+};
+
+//wp를 읽고, 그 자리에 쓰고, wp를 옮기는 동안 잡는다. 쓰기 경로, O_DIRECT, 트랜잭션 커밋, GC가 같은 위치에 쓰지 않게 한다.
+//트랜잭션의 lock을 함께 잡을 때는 hodo_trans.lock을 먼저 잡는다.
+static DEFINE_MUTEX(hodo_wp_lock);
+
+//inode block 하나에 여러 아이노드가 들어 있으므로, inode block을 읽어 고쳐 쓰고 inode_block_table, inode_slot_table을 고치는 동안 잡는다.
+//아이노드마다의 i_hodo_mutex를 잡은 채로 잡을 수 있고, 트랜잭션의 lock보다 먼저 잡는다.
+static DEFINE_MUTEX(hodo_inode_block_lock);
 
 
 /*-------------------------------------------------------------static 함수 선언-------------------------------------------------------------------------------*/
 static bool hodo_dir_emit(struct dir_context *ctx, struct hodo_dirent *temp_dirent);
 
-static void hodo_set_logical_bitmap(int i, int j);
-static void hodo_unset_logical_bitmap(int i, int j);
+static void hodo_set_logical_bitmap(unsigned long index);
+static void hodo_unset_logical_bitmap(unsigned long index);
+static long hodo_find_free_logical_index(void);
 
 static void hodo_set_GC_bitmap(struct hodo_block_pos);
 static void hodo_unset_GC_bitmap(struct hodo_block_pos);
 static struct hodo_block_pos hodo_get_next_GC_valid(void);
 
+static void hodo_victim_heap_fix(int zone_id);
+
 static ssize_t hodo_GC_write_struct(void *buf, size_t len, logical_block_number_t *logical_block_number);
 static ssize_t hodo_GC_read_struct(struct hodo_block_pos block_pos, void *out_buf, size_t len);
+
+static int hodo_extent_search(struct hodo_extent *extent, int count, uint32_t file_block);
+static int hodo_extent_array_insert(struct hodo_extent *extent, int *count, int max_count, uint32_t file_block, logical_block_number_t logical_block_number, uint32_t len);
+static int hodo_extent_grow_depth(struct hodo_inode *file_inode);
+static int hodo_extent_split_leaf(struct hodo_inode *file_inode, int index, struct hodo_extent_leaf *leaf);
+static bool hodo_extent_array_truncate(struct hodo_extent *extent, int *count, uint32_t file_block);
+static int hodo_extent_array_remove(struct hodo_extent *extent, int *count, int max_count, uint32_t start, uint32_t end);
+static int hodo_extent_array_split(struct hodo_extent *extent, int *count, int max_count, uint32_t file_block);
+static void hodo_extent_array_shift(struct hodo_extent *extent, int count, uint32_t from, int64_t delta);
+static struct hodo_extent_leaf *hodo_leaf_cache_get(logical_block_number_t leaf_logical_number);
+static int hodo_read_extent_leaf(logical_block_number_t leaf_logical_number, struct hodo_extent_leaf *leaf);
+static int hodo_write_extent_leaf(struct hodo_extent_leaf *leaf, logical_block_number_t *leaf_logical_number);
+
+static int hodo_zero_in_block(struct hodo_inode *file_inode, uint32_t file_block, uint32_t offset_in_block, uint32_t len);
+
+static void hodo_touch_dir_inode(struct hodo_inode *dir_hodo_inode, struct inode *dir, struct timespec64 now);
+
+static bool hodo_trans_stage(void *buf, size_t len, logical_block_number_t logical_block_number);
+static bool hodo_trans_read(logical_block_number_t logical_block_number, void *out_buf, size_t len);
+static void hodo_trans_forget(logical_block_number_t logical_block_number);
+static int hodo_trans_commit_locked(void);
+static bool hodo_trans_in_task_locked(void);
+
+static ssize_t hodo_write_block_locked(void *buf, size_t len, logical_block_number_t logical_block_number);
+static void hodo_map_block(logical_block_number_t logical_block_number, struct hodo_block_pos block_pos);
+static void hodo_advance_wp(uint32_t nr_blocks);
+
+static bool hodo_is_inode_slot_live(struct hodo_inode_block *inode_block, logical_block_number_t inode_block_logical_number, int slot);
+static void hodo_release_inode_slot_locked(logical_block_number_t ino);
+static void hodo_drop_physical_block(logical_block_number_t logical_block_number);
+static void hodo_release_logical_range(logical_block_number_t start, uint32_t len);
+static bool hodo_is_range_shared(logical_block_number_t start, uint32_t len);
+static bool hodo_put_shared_block(logical_block_number_t logical_block_number);
+static void hodo_clone_unshare(struct hodo_inode *src, uint32_t src_block, uint32_t nr_blocks);
+static void hodo_release_dir_blocks(struct hodo_inode *dir_hodo_inode);
+static void hodo_release_indirect_block(logical_block_number_t indirect_block_logical_number);
 /*----------------------------------------------------------------GC용 함수--------------------------------------------------------------------------------*/
+//다 쓴 zone 중 하나라도 절반 이상이 무효 블록이거나, 남은 zone이 거의 없는데 무효 블록이 있다면 GC할 때이다
 int GC_timing(void) {
-    return 1;
+    int victim = hodo_get_GC_victim();
+
+    if (victim < 0)
+        return 0;
+
+    if (hodo_get_zone_invalid_count(victim) >= HODO_GC_INVALID_THRESHOLD)
+        return 1;
+
+    if (mapping_info.wp.zone_id >= hodo_nr_zones - 3 && mapping_info.invalid_count > 0)
+        return 1;
+
+    return 0;
 }
 
 int GC(void) {
     pr_err("GC : in the GC....\n");
+    hodo_stat_inc(HODO_STAT_GC_CYCLES);
+
+    uint64_t gc_start_ns = ktime_get_ns();
+
+    //GC는 wp를 처음 zone으로 되돌리고 블록들을 다시 쓰므로, 끝날 때까지 다른 쓰기가 wp를 움직이지 못하게 한다
+    mutex_lock(&hodo_wp_lock);
+
+    int victim = hodo_get_GC_victim();
+
+    if (victim >= 0)
+        trace_hodo_gc_begin(victim, hodo_get_zone_valid_count(victim), hodo_get_zone_invalid_count(victim), mapping_info.invalid_count, mapping_info.wp);
+    else
+        trace_hodo_gc_begin(victim, 0, 0, mapping_info.invalid_count, mapping_info.wp);
+
     struct hodo_block_pos prev_wp = mapping_info.wp;
 
+    //zone별로 옮긴 블록 수(tracepoint용). hodo_get_next_GC_valid는 zone 순서대로 블록을 돌려준다.
+    int migrating_zone = -1;
+    uint32_t zone_migrated = 0;
+    uint32_t total_migrated = 0;
+
+    spin_lock(&hodo_zone_stats_lock);
     mapping_info.wp.zone_id = 1;
     mapping_info.wp.block_index = 0;
+    spin_unlock(&hodo_zone_stats_lock);
 
     mapping_info.swap_wp.zone_id = hodo_nr_zones - 2;
     mapping_info.swap_wp.block_index = 0;
 
     struct hodo_block_pos valid_block_pos = {0,0};
-    struct hodo_datablock* temp_datablock = kmalloc(HODO_DATABLOCK_SIZE, GFP_KERNEL);
+    struct hodo_datablock* temp_datablock = hodo_alloc_block();
 
     valid_block_pos = hodo_get_next_GC_valid();
     while (valid_block_pos.zone_id != 0) {
+        if (valid_block_pos.zone_id != migrating_zone) {
+            if (zone_migrated)
+                trace_hodo_gc_zone_migrated(migrating_zone, zone_migrated);
+            migrating_zone = valid_block_pos.zone_id;
+            zone_migrated = 0;
+        }
+
         hodo_GC_read_struct(valid_block_pos, temp_datablock, HODO_DATABLOCK_SIZE);
 
-        logical_block_number_t logical_block_number;
-        if (((char*)temp_datablock)[0] == 'D' && ((char*)temp_datablock)[1] == 'A' && ((char*)temp_datablock)[2] == 'T') {
-            logical_block_number = ((struct hodo_datablock*)temp_datablock)->logical_block_number;
-        }
-        else {
-            logical_block_number = ((struct hodo_inode*)temp_datablock)->i_ino;
-        }
+        logical_block_number_t logical_block_number = get_block_logical_number(valid_block_pos);
 
         hodo_GC_write_struct(temp_datablock, HODO_DATABLOCK_SIZE, &logical_block_number);
+        hodo_stat_inc(HODO_STAT_GC_MIGRATED_BLOCKS);
+        zone_migrated++;
+        total_migrated++;
 
         if (mapping_info.swap_wp.block_index >= BLOCKS_PER_ZONE-1) {
             struct hodo_block_pos swap_out_ptr = {hodo_nr_zones-2, 0};
@@ -83,6 +199,7 @@ int GC(void) {
             if (kern_path(path_buf, LOOKUP_FOLLOW, &path) == 0) {
                 inode = d_inode(path.dentry);
                 zonefs_file_truncate(inode, 0);
+                hodo_stat_inc(HODO_STAT_ZONE_RESETS);
                 path_put(&path);
             } else {
                 pr_err("Failed to resolve path: %s\n", path_buf);
@@ -92,15 +209,9 @@ int GC(void) {
                 pr_info("swapout_block index, BLOCK_PER_ZONE (%d,%d)\n", swap_out_ptr.block_index, BLOCKS_PER_ZONE);
                 hodo_GC_read_struct(swap_out_ptr, temp_datablock, HODO_DATABLOCK_SIZE);
 
-                logical_block_number_t swap_logical_block_number;
-                if (((char*)temp_datablock)[0] == 'D' && ((char*)temp_datablock)[1] == 'A' && ((char*)temp_datablock)[2] == 'T') {
-                    swap_logical_block_number = ((struct hodo_datablock*)temp_datablock)->logical_block_number;
-                }
-                else {
-                    swap_logical_block_number = ((struct hodo_inode*)temp_datablock)->i_ino;
-                }
+                logical_block_number_t swap_logical_block_number = get_block_logical_number(swap_out_ptr);
 
-                hodo_write_struct(temp_datablock, HODO_DATABLOCK_SIZE, &swap_logical_block_number);
+                hodo_write_block_locked(temp_datablock, HODO_DATABLOCK_SIZE, swap_logical_block_number);
                 pr_info("mapping info wp: (%d, %d)\n", mapping_info.wp.zone_id, mapping_info.wp.block_index);
 
                 if (swap_out_ptr.block_index == BLOCKS_PER_ZONE-1) {
@@ -116,6 +227,7 @@ int GC(void) {
             if (kern_path(path_buf, LOOKUP_FOLLOW, &path) == 0) {
                 inode = d_inode(path.dentry);
                 zonefs_file_truncate(inode, 0);
+                hodo_stat_inc(HODO_STAT_ZONE_RESETS);
                 path_put(&path);
             } else {
                 pr_err("Failed to resolve path: %s\n", path_buf);
@@ -127,6 +239,9 @@ int GC(void) {
         valid_block_pos = hodo_get_next_GC_valid();
     }
 
+    if (zone_migrated)
+        trace_hodo_gc_zone_migrated(migrating_zone, zone_migrated);
+
     // 꼬투리 zone
     if (mapping_info.swap_wp.block_index != 0) {
         // pr_info("KOTORI called!\n");
@@ -142,6 +257,7 @@ int GC(void) {
         if (kern_path(path_buf, LOOKUP_FOLLOW, &path) == 0) {
             inode = d_inode(path.dentry);
             zonefs_file_truncate(inode, 0);
+            hodo_stat_inc(HODO_STAT_ZONE_RESETS);
             path_put(&path);
         } else {
             pr_err("Failed to resolve path: %s\n", path_buf);
@@ -150,15 +266,9 @@ int GC(void) {
         while (swap_out_ptr.block_index < mapping_info.swap_wp.block_index) {
             hodo_GC_read_struct(swap_out_ptr, temp_datablock, HODO_DATABLOCK_SIZE);
 
-            logical_block_number_t swap_logical_block_number;
-            if (((char*)temp_datablock)[0] == 'D' && ((char*)temp_datablock)[1] == 'A' && ((char*)temp_datablock)[2] == 'T') {
-                swap_logical_block_number = ((struct hodo_datablock*)temp_datablock)->logical_block_number;
-            }
-            else {
-                swap_logical_block_number = ((struct hodo_inode*)temp_datablock)->i_ino;
-            }
+            logical_block_number_t swap_logical_block_number = get_block_logical_number(swap_out_ptr);
 
-            hodo_write_struct(temp_datablock, HODO_DATABLOCK_SIZE, &swap_logical_block_number);
+            hodo_write_block_locked(temp_datablock, HODO_DATABLOCK_SIZE, swap_logical_block_number);
             swap_out_ptr.block_index++;
         }
 
@@ -168,6 +278,7 @@ int GC(void) {
         if (kern_path(path_buf, LOOKUP_FOLLOW, &path) == 0) {
             inode = d_inode(path.dentry);
             zonefs_file_truncate(inode, 0);
+            hodo_stat_inc(HODO_STAT_ZONE_RESETS);
             path_put(&path);
         } else {
             pr_err("Failed to resolve path: %s\n", path_buf);
@@ -190,6 +301,7 @@ int GC(void) {
         if (kern_path(path_buf, LOOKUP_FOLLOW, &path) == 0) {
             inode = d_inode(path.dentry);
             zonefs_file_truncate(inode, 0);
+            hodo_stat_inc(HODO_STAT_ZONE_RESETS);
             path_put(&path);
         } else {
             pr_err("Failed to resolve path: %s\n", path_buf);
@@ -197,89 +309,32 @@ int GC(void) {
     }
 
 
-    kfree(temp_datablock);
+    hodo_free_block(temp_datablock);
+
+    //zone들이 비워지고 wp가 앞으로 돌아왔으므로 zone 통계를 새로 만든다
+    hodo_rebuild_zone_stats();
+    mutex_unlock(&hodo_wp_lock);
+
+    trace_hodo_gc_end(total_migrated, mapping_info.wp, ktime_get_ns() - gc_start_ns);
+    hodo_latency_record(HODO_LAT_GC, gc_start_ns);
 
     return 0;
 }
 
 /*-----------------------------------------------------------read_iter용 함수------------------------------------------------------------------------------*/
-// file_inode에서 n번째 datablock을 dst_datablock으로 copy
-void hodo_read_nth_block(struct hodo_inode *file_inode, int n, struct hodo_datablock *dst_datablock) {
+// file_inode에서 n번째 데이터블록(HODO_FILE_BLOCK_SIZE)을 dst_block으로 copy
+void hodo_read_nth_block(struct hodo_inode *file_inode, int n, void *dst_block) {
     // ZONEFS_TRACE();
-    int num_direct_block = sizeof(file_inode->direct) / sizeof((file_inode->direct)[0]);  // direct block의 개수
-    int num_block_pos_in_indirect_block = HODO_DATA_SIZE / BLOCK_PTR_SZ;
-
-    if (n < num_direct_block) { // direct block
-        // pr_info("read direct block\n");
-        logical_block_number_t data_block_logical_number = file_inode->direct[n];
-        hodo_read_struct(data_block_logical_number, dst_datablock, sizeof(struct hodo_datablock));
-    }
-    else if (n < (num_direct_block + num_block_pos_in_indirect_block)) {    // single indirect block
-        // pr_info("read single indirect block\n");
-        int nth_in_direct_block = n - num_direct_block;
-
-        struct hodo_datablock* temp_datablock = kmalloc(HODO_DATABLOCK_SIZE, GFP_KERNEL);
-        logical_block_number_t direct_block_logical_number = file_inode->single_indirect;
-        hodo_read_struct(direct_block_logical_number, temp_datablock, sizeof(struct hodo_datablock));  // read direct block
-
-        logical_block_number_t data_block_logical_number;
-        memcpy(&data_block_logical_number, (char*)temp_datablock + HODO_DATA_START + (nth_in_direct_block * BLOCK_PTR_SZ), BLOCK_PTR_SZ);
-        hodo_read_struct(data_block_logical_number, dst_datablock, sizeof(struct hodo_datablock));
-
-        kfree(temp_datablock);
-    }
-    else if (n < (num_direct_block + num_block_pos_in_indirect_block + (num_block_pos_in_indirect_block * num_block_pos_in_indirect_block))) {    // double indirect block
-        // pr_info("read double indirect block\n");
-        int nth_in_single_indirect_block = (n - (num_direct_block + num_block_pos_in_indirect_block)) / num_block_pos_in_indirect_block;
-        int nth_in_direct_block = (n - (num_direct_block + num_block_pos_in_indirect_block)) % num_block_pos_in_indirect_block;
-
-        struct hodo_datablock *temp_datablock = kmalloc(HODO_DATABLOCK_SIZE, GFP_KERNEL);
-        logical_block_number_t single_indirect_logical_number = file_inode->double_indirect;
-        hodo_read_struct(single_indirect_logical_number, temp_datablock, sizeof(struct hodo_datablock));
-
-        logical_block_number_t direct_block_logical_number = 0;
-        memcpy(&direct_block_logical_number, (char*)temp_datablock + HODO_DATA_START + (nth_in_single_indirect_block * BLOCK_PTR_SZ), BLOCK_PTR_SZ);
-        hodo_read_struct(direct_block_logical_number, temp_datablock, sizeof(struct hodo_datablock));
-
-        logical_block_number_t data_block_logical_number= 0;
-        memcpy(&data_block_logical_number, (char*)temp_datablock + HODO_DATA_START + (nth_in_direct_block * BLOCK_PTR_SZ), BLOCK_PTR_SZ);
-        hodo_read_struct(data_block_logical_number, dst_datablock, sizeof(struct hodo_datablock));
+    uint32_t extent_len;
+    logical_block_number_t data_block_logical_number = hodo_extent_lookup(file_inode, n, &extent_len);
 
-        kfree(temp_datablock);
+    //extent에 없는 블록은 구멍(hole)이므로 장치를 읽지 않고 0으로 채운다
+    if (!is_block_logical_number_valid(data_block_logical_number)) {
+        memset(dst_block, 0, HODO_FILE_BLOCK_SIZE);
+        return;
     }
-    else {  // triple indirect block
-        // pr_info("read triple indirect block\n");
-        int nth_in_double_indirect_block = (n - (num_direct_block + num_block_pos_in_indirect_block + (num_block_pos_in_indirect_block * num_block_pos_in_indirect_block)));
-        nth_in_double_indirect_block /= (num_block_pos_in_indirect_block * num_block_pos_in_indirect_block);
 
-        int nth_in_single_indirect_block = (n - (num_direct_block + num_block_pos_in_indirect_block + (num_block_pos_in_indirect_block * num_block_pos_in_indirect_block)));
-        nth_in_single_indirect_block %= (num_block_pos_in_indirect_block * num_block_pos_in_indirect_block);
-        nth_in_single_indirect_block /= num_block_pos_in_indirect_block;
-
-        int nth_in_direct_block = (n - (num_direct_block + num_block_pos_in_indirect_block + (num_block_pos_in_indirect_block * num_block_pos_in_indirect_block)));
-        nth_in_direct_block %= (num_block_pos_in_indirect_block * num_block_pos_in_indirect_block); 
-        nth_in_direct_block %= num_block_pos_in_indirect_block;
-
-        struct hodo_datablock *temp_datablock = kmalloc(HODO_DATABLOCK_SIZE, GFP_KERNEL);
-
-        logical_block_number_t double_indirect_block_logical_number = file_inode->triple_indirect;
-        hodo_read_struct(double_indirect_block_logical_number, temp_datablock, sizeof(struct hodo_datablock));
-
-        logical_block_number_t single_indirect_block_logical_number = 0;
-        memcpy(&single_indirect_block_logical_number, (char*)temp_datablock + HODO_DATA_START + (nth_in_double_indirect_block * BLOCK_PTR_SZ), BLOCK_PTR_SZ);
-        hodo_read_struct(single_indirect_block_logical_number, temp_datablock, sizeof(struct hodo_datablock));
-
-        logical_block_number_t direct_block_logical_number = 0;
-        memcpy(&direct_block_logical_number, (char*)temp_datablock + HODO_DATA_START + (nth_in_single_indirect_block * BLOCK_PTR_SZ), BLOCK_PTR_SZ);
-        hodo_read_struct(direct_block_logical_number, temp_datablock, sizeof(struct hodo_datablock));
-
-        logical_block_number_t data_block_logical_number = 0;
-        memcpy(&data_block_logical_number, (char*)temp_datablock + HODO_DATA_START + (nth_in_direct_block * BLOCK_PTR_SZ), BLOCK_PTR_SZ);
-        hodo_read_struct(data_block_logical_number, dst_datablock, sizeof(struct hodo_datablock));
-
-        kfree(temp_datablock);
-    }
-    return;
+    hodo_read_struct(data_block_logical_number, dst_block, HODO_FILE_BLOCK_SIZE);
 }
 
 /*-------------------------------------------------------------write_iter용 함수 선언----------------------------------------------------------------------------*/
@@ -293,1003 +348,3039 @@ ssize_t write_one_block(struct kiocb *iocb, struct iov_iter *from){
     uint64_t target_mapping_index = target_ino;
 
     //타겟 파일의 아이노드를 불러오기.
-    struct hodo_inode target_hodo_inode;
+    struct hodo_inode *target_hodo_inode = hodo_alloc_block();
     logical_block_number_t target_inode_logical_number;
 
     target_inode_logical_number = target_mapping_index;
-    hodo_read_struct(target_inode_logical_number, &target_hodo_inode, sizeof(struct hodo_inode));
+
+    //hodo 아이노드를 다시 쓸 때까지 같은 파일의 다른 쓰기나 writeback이 아이노드를 고치지 못하게 한다
+    hodo_lock_inode(target_inode);
+    hodo_read_inode(target_inode_logical_number, target_hodo_inode);
 
     if (iocb->ki_flags & IOCB_APPEND)
         iocb->ki_pos = i_size_read(target_inode);
     // pr_info("zonefs: write_iter original target offset is %d, new i_size is %d\n", iocb->ki_pos, target_inode->i_size);
-    
-    //어디에다가 파일을 쓸지를 추가한다.
-    struct hodo_datablock *target_block = kmalloc(HODO_DATABLOCK_SIZE, GFP_KERNEL);
+
+    loff_t offset = iocb->ki_pos;
+    loff_t data_block_index = offset / HODO_FILE_BLOCK_SIZE;
+    uint64_t offset_in_block = offset % HODO_FILE_BLOCK_SIZE;
+
+    //파일시스템 상 파일의 최대 크기를 넘어선 오프셋에는 쓰기가 불가능 하다
+    if (data_block_index >= HODO_MAX_FILE_BLOCKS) {
+        hodo_unlock_inode(target_inode);
+        hodo_free_block(target_hodo_inode);
+        return -EFBIG;
+    }
+
+    //어디에다가 파일을 쓸지를 추가한다. 일반 파일의 데이터블록은 헤더가 없으므로 블록 전체가 파일 내용이다.
+    char *target_block = hodo_alloc_block();
     if (target_block == NULL) {
         // pr_info("zonefs: (error in hodo_sub_file_write_iter) cannot allocate 4KB heap space for datablock variable\n");
+        hodo_unlock_inode(target_inode);
+        hodo_free_block(target_hodo_inode);
         return -ENOMEM;
     }
 
-    uint64_t num_of_block_poses_in_datablock = HODO_DATA_SIZE/BLOCK_PTR_SZ;
-
-    loff_t offset = iocb->ki_pos;
-    loff_t data_block_index = offset / HODO_DATA_SIZE;
-    uint64_t num_of_direct_blocks_in_hodo_inode            = 10;
-    uint64_t num_of_direct_blocks_in_single_indirect_block = num_of_block_poses_in_datablock;
-    uint64_t num_of_direct_blocks_in_double_indirect_block = num_of_block_poses_in_datablock * num_of_block_poses_in_datablock;
-    uint64_t num_of_direct_blocks_in_triple_indirect_block = num_of_block_poses_in_datablock * num_of_block_poses_in_datablock * num_of_block_poses_in_datablock;
-
-    ssize_t written_size = 0;
-    if(data_block_index         < num_of_direct_blocks_in_hodo_inode){
-        //direct_data_block(0~9)에 쓸 위치가 존재
-        // pr_info("zonefs: write_iter in direct_data_block\n");
-
-        if(is_block_logical_number_valid(target_hodo_inode.direct[data_block_index]))
-            hodo_read_struct(target_hodo_inode.direct[data_block_index], target_block, HODO_DATABLOCK_SIZE);
-        else {
-            target_block->magic[0] = 'D';
-            target_block->magic[1] = 'A';
-            target_block->magic[2] = 'T';
-            target_block->magic[3] = '0';
+    //우리가 이 함수 한 번에서 쓰는 양은 한 블록을 넘지 않는다.
+    //쓰려고 하는 데이터 양이 데이터 블락을 넘어서는 경우는, VFS가 알아서 쓰기 잔여량을 보고서 재호출하는 기능에 의지하도록 한다.
+    uint64_t written_size = min_t(uint64_t, iov_iter_count(from), HODO_FILE_BLOCK_SIZE - offset_in_block);
+
+    uint32_t extent_len;
+    logical_block_number_t written_logical_number = hodo_extent_lookup(target_hodo_inode, data_block_index, &extent_len);
+    bool is_new_block = !is_block_logical_number_valid(written_logical_number);
+
+    if (is_new_block) {
+        memset(target_block, 0, HODO_FILE_BLOCK_SIZE);
+
+        //바로 앞 파일 블록의 다음 논리 번호를 받으면 앞의 extent가 늘어나기만 하므로, 가능하면 그 번호를 받는다
+        logical_block_number_t prev_logical_number = 0;
+        if (data_block_index > 0)
+            prev_logical_number = hodo_extent_lookup(target_hodo_inode, data_block_index - 1, &extent_len);
+
+        int new_logical_number;
+        if (is_block_logical_number_valid(prev_logical_number))
+            new_logical_number = hodo_get_logical_number_near(prev_logical_number + 1);
+        else
+            new_logical_number = hodo_get_next_logical_number();
+
+        if (new_logical_number < 0) {
+            hodo_free_block(target_block);
+            hodo_unlock_inode(target_inode);
+            hodo_free_block(target_hodo_inode);
+            return new_logical_number;
         }
+        written_logical_number = new_logical_number;
+    }
+    else if (offset_in_block != 0 || written_size != HODO_FILE_BLOCK_SIZE) {
+        //블록의 일부만 덮어쓰는 경우에는 이전에 쓰인 데이터(left over)를 읽어서 새로 쓸 데이터랑 합쳐서 쓰도록 한다.
+        hodo_read_struct(written_logical_number, target_block, HODO_FILE_BLOCK_SIZE);
+    }
 
-        logical_block_number_t written_logical_number = target_hodo_inode.direct[data_block_index];
-        written_size = write_one_block_by_direct_block(iocb, from, &written_logical_number, target_block);
+    if (copy_from_iter(target_block + offset_in_block, written_size, from) != written_size) {
+        if (is_new_block)
+            hodo_erase_table_entry(written_logical_number);
+        hodo_free_block(target_block);
+        hodo_unlock_inode(target_inode);
+        hodo_free_block(target_hodo_inode);
+        return -EFAULT;
+    }
 
-        target_hodo_inode.direct[data_block_index] = written_logical_number;
-        target_hodo_inode.file_len = iocb->ki_pos + written_size;
-    } 
-    else if(data_block_index    < num_of_direct_blocks_in_hodo_inode + num_of_direct_blocks_in_single_indirect_block){
-        //singe_indirect_data_block에 쓸 위치가 존재
-        // pr_info("zonefs: write_iter in single_indirect_data_block\n");
+    //다른 파일과 나눠 쓰는 블록은 그 자리에 덮어쓰지 않고, 이 파일만 새 논리 번호로 옮겨 쓴다(copy-on-write)
+    //새 번호를 먼저 받아 두어, 받지 못했다면 extent를 건드리지 않고 끝낸다
+    if (!is_new_block && hodo_is_block_shared(written_logical_number)) {
+        int new_logical_number = hodo_get_next_logical_number();
 
-        if(is_block_logical_number_valid(target_hodo_inode.single_indirect))
-            hodo_read_struct(target_hodo_inode.single_indirect, target_block, HODO_DATABLOCK_SIZE);
-        else {
-            target_block->magic[0] = 'D';
-            target_block->magic[1] = 'A';
-            target_block->magic[2] = 'T';
-            target_block->magic[3] = '1';
+        if (new_logical_number < 0) {
+            hodo_free_block(target_block);
+            hodo_unlock_inode(target_inode);
+            hodo_free_block(target_hodo_inode);
+            return new_logical_number;
         }
 
-        logical_block_number_t written_logical_number = target_hodo_inode.single_indirect;
-        written_size = write_one_block_by_indirect_block(iocb, from, &written_logical_number, target_block);
-
-        target_hodo_inode.single_indirect = written_logical_number;
-        target_hodo_inode.file_len = iocb->ki_pos + written_size;
+        hodo_extent_remove_range(target_hodo_inode, data_block_index, data_block_index + 1);
+        written_logical_number = new_logical_number;
+        is_new_block = true;
     }
-    else if(data_block_index    < num_of_direct_blocks_in_hodo_inode + num_of_direct_blocks_in_single_indirect_block + num_of_direct_blocks_in_double_indirect_block){
-        //double_indirect_data_block에 쓸 위치가 존재
-        // pr_info("zonefs: write_iter in double_indirect_data_block\n");
-
-        if(is_block_logical_number_valid(target_hodo_inode.double_indirect))
-            hodo_read_struct(target_hodo_inode.double_indirect, target_block, HODO_DATABLOCK_SIZE);
-        else {
-            target_block->magic[0] = 'D';
-            target_block->magic[1] = 'A';
-            target_block->magic[2] = 'T';
-            target_block->magic[3] = '2';
-        }
 
-        logical_block_number_t written_logical_number = target_hodo_inode.double_indirect;
-        written_size = write_one_block_by_indirect_block(iocb, from, &written_logical_number, target_block);
+    //덮어쓰기는 같은 논리 번호에 다시 쓰므로, 매핑 테이블만 바뀌고 extent는 그대로이다
+    hodo_write_struct(target_block, HODO_FILE_BLOCK_SIZE, &written_logical_number);
+    hodo_free_block(target_block);
 
-        target_hodo_inode.double_indirect = written_logical_number;
-        target_hodo_inode.file_len = iocb->ki_pos + written_size;
-    }
-    else if(data_block_index    < num_of_direct_blocks_in_hodo_inode + num_of_direct_blocks_in_single_indirect_block + num_of_direct_blocks_in_double_indirect_block + num_of_direct_blocks_in_triple_indirect_block){
-        //triple_indirect_data_block에 쓸 위치가 존재
-        // pr_info("zonefs: write_iter in triple_indirect_data_block\n");
-
-        if(is_block_logical_number_valid(target_hodo_inode.triple_indirect))
-            hodo_read_struct(target_hodo_inode.triple_indirect, target_block, HODO_DATABLOCK_SIZE);
-        else {
-            target_block->magic[0] = 'D';
-            target_block->magic[1] = 'A';
-            target_block->magic[2] = 'T';
-            target_block->magic[3] = '3';
+    if (is_new_block) {
+        int ret = hodo_extent_insert(target_hodo_inode, data_block_index, written_logical_number);
+        if (ret < 0) {
+            hodo_drop_physical_block(written_logical_number);
+            hodo_erase_table_entry(written_logical_number);
+            hodo_unlock_inode(target_inode);
+            hodo_free_block(target_hodo_inode);
+            return ret;
         }
-
-        logical_block_number_t written_logical_number = target_hodo_inode.triple_indirect;
-        written_size = write_one_block_by_indirect_block(iocb, from, &written_logical_number, target_block);
-
-        target_hodo_inode.triple_indirect = written_logical_number;
-        target_hodo_inode.file_len = iocb->ki_pos + written_size;
-    }
-    else {
-        //파일시스템 상 파일의 최대 크기를 넘어선 오프셋에는 쓰기가 불가능 하다
-        // pr_info("zonefs: (error in hodo_sub_file_write_iter) write_iter over the triple_indirect_data_block. we cannot do it.\n");
-        kfree(target_block);
-        return -EFBIG;
     }
 
-    //데이터 블록이 새로 써졌으므로, 파일의 hodo 아이노드도 새로 쓰도록 한다
-    hodo_write_struct(&target_hodo_inode, sizeof(struct hodo_inode), &target_inode_logical_number);
+    if (target_hodo_inode->file_len < offset + written_size)
+        target_hodo_inode->file_len = offset + written_size;
 
-    //실제로 쓰기가 수행된 길이를 반환한다. 만약 이것이 요청된 쓰기 길이에 미치지 못한다면, VFS는 나머지 부분을 재호출 할 것이다.
-    kfree(target_block);
+    //데이터 블록이 새로 써졌으므로, 파일의 hodo 아이노드도 새로 쓰도록 한다. 메모리에만 있던 시각도 함께 싣는다.
+    hodo_load_inode_times(target_hodo_inode, target_inode);
+    hodo_write_inode(target_hodo_inode);
 
+    //실제로 쓰기가 수행된 길이를 반환한다. 만약 이것이 요청된 쓰기 길이에 미치지 못한다면, VFS는 나머지 부분을 재호출 할 것이다.
     iocb->ki_pos += written_size;
-    i_size_write(target_inode, iocb->ki_pos);
+    i_size_write(target_inode, target_hodo_inode->file_len);
+    hodo_unlock_inode(target_inode);
     // pr_info("zonefs: write_iter new target offset is %d, new i_size is %d\n", iocb->ki_pos, target_inode->i_size);
+    hodo_free_block(target_hodo_inode);
     return written_size;
 }
 
-ssize_t write_one_block_by_direct_block(struct kiocb *iocb, struct iov_iter *from, logical_block_number_t *out_logical_number, struct hodo_datablock *current_direct_block){
+//O_DIRECT 쓰기. 사용자 버퍼를 wp 위치의 seq zone 파일에 그대로 쓰고, 쓰인 파일 블록들의 논리 번호를 새 위치로 옮긴다.
+//파일 블록 단위로 정렬된 요청만 들어오며, 한 번에 wp가 있는 zone의 남은 자리까지만 쓴다.
+ssize_t write_direct_blocks(struct kiocb *iocb, struct iov_iter *from){
     // ZONEFS_TRACE();
 
-    struct hodo_datablock *target_block = kmalloc(HODO_DATABLOCK_SIZE, GFP_KERNEL);
-    if (target_block == NULL) {
-        // pr_info("zonefs: (error in hodo_sub_file_write_iter) cannot allocate 4KB heap space for datablock variable\n");
-        return -ENOMEM;
-    }
+    struct inode *target_inode = iocb->ki_filp->f_inode;
+    struct hodo_inode *target_hodo_inode = hodo_alloc_block();
 
-    target_block->magic[0] = 'D';
-    target_block->magic[1] = 'A';
-    target_block->magic[2] = 'T';
-    target_block->magic[3] = '0';
+    hodo_lock_inode(target_inode);
+    hodo_read_inode(target_inode->i_ino, target_hodo_inode);
 
-    loff_t offset = iocb->ki_pos;
-    uint64_t len = iov_iter_count(from);
+    if (iocb->ki_flags & IOCB_APPEND)
+        iocb->ki_pos = i_size_read(target_inode);
 
-    //쓰고자 하는 데이터를 실제로 데이터 블록에다가 쓴다. 단, 우리가 이 함수 한 번에서 쓰는 양은 한 블록을 넘지 않는다.
-    //쓰려고 하는 데이터 양이 데이터 블락을 넘어서는 경우는, VFS가 알아서 쓰기 잔여량을 보고서 재호출하는 기능에 의지하도록 한다.
-    uint64_t left_len = offset % HODO_DATA_SIZE;
-    if((left_len != 0) && current_direct_block != NULL) {
-        //current_direct_block의 일부에 이미 이전에 쓰인 데이터(left over)가 있다면, 이들을 새로 쓸 데이터랑 합쳐서 쓰도록 한다.
-        // pr_info("zonefs: write_iter with left over\n");
-        memcpy(target_block->data, current_direct_block->data, left_len);
-
-        if(len + left_len >= HODO_DATA_SIZE){
-            //left over를 합쳐서 쓰려고 하는 데이터가 데이터 블럭을 넘어선다면 하나의 블럭 크기만 쓴다.
-            if(copy_from_iter((void *)(target_block->data) + left_len, HODO_DATA_SIZE - left_len, from) != HODO_DATA_SIZE - left_len){
-                kfree(target_block);
-                return -EFAULT;
-            }
+    loff_t offset = iocb->ki_pos;
+    loff_t data_block_index = offset / HODO_FILE_BLOCK_SIZE;
+    size_t left_len = iov_iter_count(from);
 
-            hodo_write_struct(target_block, HODO_DATABLOCK_SIZE, out_logical_number);
-            kfree(target_block);
-            return HODO_DATA_SIZE - left_len;
-        }
-        else {
-            //left over을 합쳐서 쓰려고 하는 데이터가 데이터 블럭 크기 이내라면 그만큼만 쓴다.
-            if(copy_from_iter((void *)(target_block->data) + left_len, len, from) != len){
-                kfree(target_block);
-                return -EFAULT;
-            }
+    //블록마다 쓸 논리 번호는 new_logical_number에 모아 두므로, 한 번에 쓰는 블록 수는 이 배열의 크기를 넘지 않는다
+    uint32_t nr_blocks = min_t(uint64_t, left_len / HODO_FILE_BLOCK_SIZE, HODO_DATABLOCK_SIZE / sizeof(logical_block_number_t));
 
-            hodo_write_struct(target_block, HODO_DATABLOCK_SIZE, out_logical_number);
-            kfree(target_block);
-            return len;
-        }
+    //파일시스템 상 파일의 최대 크기를 넘어선 오프셋에는 쓰기가 불가능 하다
+    if (data_block_index + nr_blocks > HODO_MAX_FILE_BLOCKS) {
+        hodo_unlock_inode(target_inode);
+        hodo_free_block(target_hodo_inode);
+        return -EFBIG;
     }
-    else {
-        //쓰려고 하는 블록이 깔끔하다면, 새로 쓰고자 하는 내용만 쓴다.
-        // pr_info("zonefs: write_iter without left over\n");
-        if(len >= HODO_DATA_SIZE){
-            //쓰려고 하는 데이터가 데이터 블럭을 넘어선다면 하나의 블럭 크기만 쓴다.
-            if(copy_from_iter(target_block->data, HODO_DATA_SIZE, from) != HODO_DATA_SIZE){
-                kfree(target_block);
-                return -EFAULT;
-            }
 
-            hodo_write_struct(target_block, HODO_DATABLOCK_SIZE, out_logical_number);
-            kfree(target_block);
-            return HODO_DATA_SIZE;
+    //GC는 GC_bitmap과 zone_summary에 올라간 블록만 옮기므로, 쓰인 블록들은 wp lock을 놓기 전에 모두 매핑해야 한다.
+    //extent를 읽으면 트랜잭션과 extent leaf cache의 lock을 잡으므로, 블록마다의 논리 번호는 wp lock을 잡기 전에 미리 정해 둔다.
+    //덮어쓰기는 같은 논리 번호를 새 위치로 옮기기만 하면 된다. 구멍이나 나눠 쓰는 블록은 새 논리 번호를 받는다(is_new에 표시).
+    logical_block_number_t *new_logical_number = hodo_alloc_block();
+    unsigned long *is_new = hodo_alloc_block();
+
+    bitmap_zero(is_new, nr_blocks);
+
+    for (uint32_t i = 0; i < nr_blocks; i++) {
+        uint32_t extent_len;
+        uint32_t file_block = data_block_index + i;
+        logical_block_number_t logical_number = hodo_extent_lookup(target_hodo_inode, file_block, &extent_len);
+
+        if (is_block_logical_number_valid(logical_number) && !hodo_is_block_shared(logical_number)) {
+            new_logical_number[i] = logical_number;
+            continue;
         }
-        else {
-            //쓰려고 하는 데이터가 데이터 블럭 크기 이내라면 그만큼만 쓴다.
-            if(copy_from_iter(target_block->data, len, from) != len){
-                kfree(target_block);
-                return -EFAULT;
-            }
 
-            hodo_write_struct(target_block, HODO_DATABLOCK_SIZE, out_logical_number);
-            kfree(target_block);
-            return len;
+        //앞 파일 블록이 이번에 새 번호를 받았다면 아직 extent에 없으므로 그 번호에 이어 받는다
+        logical_block_number_t prev_logical_number = 0;
+        if (i > 0 && test_bit(i - 1, is_new))
+            prev_logical_number = new_logical_number[i - 1];
+        else if (file_block > 0)
+            prev_logical_number = hodo_extent_lookup(target_hodo_inode, file_block - 1, &extent_len);
+
+        int logical_number_or_err;
+        if (is_block_logical_number_valid(prev_logical_number))
+            logical_number_or_err = hodo_get_logical_number_near(prev_logical_number + 1);
+        else
+            logical_number_or_err = hodo_get_next_logical_number();
+
+        //논리 번호가 떨어졌다면 번호를 받은 앞쪽 블록들까지만 쓴다
+        if (logical_number_or_err < 0) {
+            nr_blocks = i;
+            break;
         }
+
+        new_logical_number[i] = logical_number_or_err;
+        __set_bit(i, is_new);
     }
-}
 
-ssize_t write_one_block_by_indirect_block(struct kiocb *iocb, struct iov_iter *from, logical_block_number_t *out_logical_number, struct hodo_datablock *current_indirect_block){
-    // ZONEFS_TRACE();
+    if (nr_blocks == 0) {
+        hodo_free_block(is_new);
+        hodo_free_block(new_logical_number);
+        hodo_unlock_inode(target_inode);
+        hodo_free_block(target_hodo_inode);
+        return -ENOSPC;
+    }
 
-    //offset을 통해서, 현재 indirect_block 속에 나열 된 block_pos중 무엇을 사용해야 할지 알아낸다.
-    uint64_t block_pos_index_in_current_indirect_block = 0;
+    //쓸 자리를 고르고, 쓰고, 쓰인 블록들을 매핑할 때까지 다른 쓰기나 GC가 wp를 움직이지 못하게 한다
+    mutex_lock(&hodo_wp_lock);
 
-    uint64_t num_of_block_poses_in_datablock = HODO_DATA_SIZE/BLOCK_PTR_SZ;
+    uint32_t blocks_left_in_zone = hodo_zone_size / HODO_DATABLOCK_SIZE - mapping_info.wp.block_index;
+    uint32_t nr_to_write = min_t(uint32_t, nr_blocks, blocks_left_in_zone);
+    struct hodo_block_pos block_pos = mapping_info.wp;
 
-    loff_t offset = iocb->ki_pos;
-    loff_t data_block_index = offset / HODO_DATA_SIZE;
-    uint64_t num_of_direct_blocks_in_hodo_inode            = 10;
-    uint64_t num_of_direct_blocks_in_single_indirect_block = num_of_block_poses_in_datablock;
-    uint64_t num_of_direct_blocks_in_double_indirect_block = num_of_block_poses_in_datablock * num_of_block_poses_in_datablock;
-    uint64_t num_of_direct_blocks_in_triple_indirect_block = num_of_block_poses_in_datablock * num_of_block_poses_in_datablock * num_of_block_poses_in_datablock;
-
-    if(data_block_index         < num_of_direct_blocks_in_hodo_inode){
-        // pr_info("zonefs: (error in hodo_sub_file_write_iter) processing in direct block should not reach here\n");
-        return -EIO;
-    }
-    else if(data_block_index    < num_of_direct_blocks_in_hodo_inode + num_of_direct_blocks_in_single_indirect_block){
-        uint64_t block_pos_index_in_single_indirect_datablock = (data_block_index - num_of_direct_blocks_in_hodo_inode);
-        block_pos_index_in_current_indirect_block = block_pos_index_in_single_indirect_datablock;
-        // pr_info("DAT1 : calculated offset in indirect_block : %d\n", block_pos_index_in_current_indirect_block);
-    }
-    else if(data_block_index    < num_of_direct_blocks_in_hodo_inode + num_of_direct_blocks_in_single_indirect_block + num_of_direct_blocks_in_double_indirect_block){
-        uint64_t block_pos_index_in_double_indirect_datablock = (data_block_index - num_of_direct_blocks_in_hodo_inode - num_of_direct_blocks_in_single_indirect_block) / num_of_block_poses_in_datablock;
-        uint64_t block_pos_index_in_single_indirect_datablock = (data_block_index - num_of_direct_blocks_in_hodo_inode - num_of_direct_blocks_in_single_indirect_block) % num_of_block_poses_in_datablock;
-        if(
-            current_indirect_block->magic[0] == 'D' &&
-            current_indirect_block->magic[1] == 'A' &&
-            current_indirect_block->magic[2] == 'T' &&
-            current_indirect_block->magic[3] == '2'
-        ){
-            block_pos_index_in_current_indirect_block = block_pos_index_in_double_indirect_datablock;
-        }
-        else if(
-            current_indirect_block->magic[0] == 'D' &&
-            current_indirect_block->magic[1] == 'A' &&
-            current_indirect_block->magic[2] == 'T' &&
-            current_indirect_block->magic[3] == '1'
-        ){
-            block_pos_index_in_current_indirect_block = block_pos_index_in_single_indirect_datablock;
-        }
-        else {
-            return -EIO;
-        }
+    iov_iter_truncate(from, (size_t)nr_to_write * HODO_FILE_BLOCK_SIZE);
+    ssize_t written_size = hodo_write_zone_iter(block_pos, from);
+    iov_iter_reexpand(from, left_len - (written_size > 0 ? written_size : 0));
 
-        // pr_info("DAT2 : calculated offset in indirect_block : %d\n", block_pos_index_in_current_indirect_block);
-    }
-    else if(data_block_index    < num_of_direct_blocks_in_hodo_inode + num_of_direct_blocks_in_single_indirect_block + num_of_direct_blocks_in_double_indirect_block + num_of_direct_blocks_in_triple_indirect_block){
-        uint64_t block_pos_index_in_triple_indirect_datablock = (data_block_index - num_of_direct_blocks_in_hodo_inode - num_of_direct_blocks_in_single_indirect_block - num_of_direct_blocks_in_double_indirect_block) / num_of_block_poses_in_datablock / num_of_block_poses_in_datablock;
-        uint64_t block_pos_index_in_double_indirect_datablock = (data_block_index - num_of_direct_blocks_in_hodo_inode - num_of_direct_blocks_in_single_indirect_block - num_of_direct_blocks_in_double_indirect_block) / num_of_block_poses_in_datablock % num_of_block_poses_in_datablock;
-        uint64_t block_pos_index_in_single_indirect_datablock = (data_block_index - num_of_direct_blocks_in_hodo_inode - num_of_direct_blocks_in_single_indirect_block - num_of_direct_blocks_in_double_indirect_block) % num_of_block_poses_in_datablock;
-        if(
-            current_indirect_block->magic[0] == 'D' &&
-            current_indirect_block->magic[1] == 'A' &&
-            current_indirect_block->magic[2] == 'T' &&
-            current_indirect_block->magic[3] == '3'
-        ){
-            block_pos_index_in_current_indirect_block = block_pos_index_in_triple_indirect_datablock;
-        }
-        else if(
-            current_indirect_block->magic[0] == 'D' &&
-            current_indirect_block->magic[1] == 'A' &&
-            current_indirect_block->magic[2] == 'T' &&
-            current_indirect_block->magic[3] == '2'
-        ){
-            block_pos_index_in_current_indirect_block = block_pos_index_in_double_indirect_datablock;
-        }
-        else if(
-            current_indirect_block->magic[0] == 'D' &&
-            current_indirect_block->magic[1] == 'A' &&
-            current_indirect_block->magic[2] == 'T' &&
-            current_indirect_block->magic[3] == '1'
-        ){
-            block_pos_index_in_current_indirect_block = block_pos_index_in_single_indirect_datablock;
-        }
-        else {
-            return -EIO;
-        }
+    uint32_t nr_written = written_size > 0 ? written_size / HODO_FILE_BLOCK_SIZE : 0;
+
+    if (written_size > 0)
+        hodo_advance_wp(DIV_ROUND_UP(written_size, HODO_FILE_BLOCK_SIZE));
+
+    for (uint32_t i = 0; i < nr_written; i++) {
+        struct hodo_block_pos written_pos = {block_pos.zone_id, block_pos.block_index + i};
+
+        hodo_map_block(new_logical_number[i], written_pos);
     }
-    else{
-        // pr_info("zonefs: (error in hodo_sub_file_write_iter) write_iter over the triple_indirect_data_block. we cannot do it.\n");
-        return -EFBIG;
+    mutex_unlock(&hodo_wp_lock);
+
+    //쓰이지 않은 블록 몫으로 받아 둔 새 논리 번호는 돌려준다
+    for (uint32_t i = nr_written; i < nr_blocks; i++) {
+        if (test_bit(i, is_new))
+            hodo_erase_table_entry(new_logical_number[i]);
     }
 
-    void* address_of_target_block_pos_in_current_block = (void*)(current_indirect_block->data) + block_pos_index_in_current_indirect_block * BLOCK_PTR_SZ;
-    logical_block_number_t target_block_logical_number = 0;
-    memcpy(&target_block_logical_number, address_of_target_block_pos_in_current_block, BLOCK_PTR_SZ);
+    //새 논리 번호들을 extent에 넣는다. 나눠 쓰던 블록이었다면 이 파일의 extent에서만 떼어 낸다.
+    for (uint32_t i = 0; i < nr_written; i++) {
+        uint32_t extent_len;
+        uint32_t file_block = data_block_index + i;
 
-    //위에서 알아낸 block_pos가 유효하다면 해당 데이터블록을 저장장치로부터 읽어낸다. 이렇게 읽어낸 블록은 이전 데이터 블록보다 간접 차수가 1 낮은 데이터 블록이다.
-    struct hodo_datablock *target_block = kmalloc(HODO_DATABLOCK_SIZE, GFP_KERNEL);
-    if (target_block == NULL) {
-        // pr_info("zonefs: (error in hodo_sub_file_write_iter) cannot allocate 4KB heap space for datablock variable\n");
-        return -ENOMEM;
-    }
+        if (!test_bit(i, is_new))
+            continue;
 
-    logical_block_number_t written_logical_number = 0;
-    //호출할 함수가 write_one_block_by_indirect_block인지, write_one_block_by_direct_block인지를 분간해서 재귀를 호출한다.
-    //분간하기 위해서 유효한 target_block이라면 magic을 확인한다.
-    if(is_block_logical_number_valid(target_block_logical_number)) {
-        hodo_read_struct(target_block_logical_number, target_block, HODO_DATABLOCK_SIZE);
+        if (is_block_logical_number_valid(hodo_extent_lookup(target_hodo_inode, file_block, &extent_len)))
+            hodo_extent_remove_range(target_hodo_inode, file_block, file_block + 1);
+
+        int ret = hodo_extent_insert(target_hodo_inode, file_block, new_logical_number[i]);
+        if (ret < 0) {
+            //extent에 넣지 못한 새 논리 번호들은 이미 매핑되었으므로 모두 되돌린다
+            for (uint32_t j = i; j < nr_written; j++) {
+                if (!test_bit(j, is_new))
+                    continue;
+                hodo_drop_physical_block(new_logical_number[j]);
+                hodo_erase_table_entry(new_logical_number[j]);
+            }
 
-        written_logical_number = target_block_logical_number;
-    }
-    else {
-        target_block->magic[0] = 'D';
-        target_block->magic[1] = 'A';
-        target_block->magic[2] = 'T';
-        target_block->magic[3] = current_indirect_block->magic[3] - 1;
+            written_size = (ssize_t)i * HODO_FILE_BLOCK_SIZE;
+            if (written_size == 0)
+                written_size = ret;
+            break;
+        }
     }
 
-    ssize_t written_size = 0;
+    hodo_free_block(is_new);
+    hodo_free_block(new_logical_number);
 
-    if(is_directblock(target_block)){
-        // pr_info("DAT1->DAT0 : calculated offset in indirect_block : %d\n", block_pos_index_in_current_indirect_block);
-        written_size = write_one_block_by_direct_block(iocb, from, &written_logical_number, target_block);
+    if (written_size <= 0) {
+        hodo_unlock_inode(target_inode);
+        hodo_free_block(target_hodo_inode);
+        return written_size;
     }
-    else
-        written_size = write_one_block_by_indirect_block(iocb, from, &written_logical_number, target_block);
 
-    //아래 차수의 데이터 블록이 새로 써졌으니, 이를 가리키는 block pos도 새 것으로 대체해서 현재 데이터 블록도 새로 쓰고서 그 위치를 상위 함수에 반환하여야 한다.
-    if (written_size > 0 && is_block_logical_number_valid(written_logical_number)){
-        memcpy(address_of_target_block_pos_in_current_block, &written_logical_number, BLOCK_PTR_SZ);
-        hodo_write_struct(current_indirect_block, sizeof(struct hodo_datablock), out_logical_number);
-    }
+    if (target_hodo_inode->file_len < offset + written_size)
+        target_hodo_inode->file_len = offset + written_size;
+
+    hodo_load_inode_times(target_hodo_inode, target_inode);
+    hodo_write_inode(target_hodo_inode);
 
-    kfree(target_block);
+    iocb->ki_pos += written_size;
+    i_size_write(target_inode, target_hodo_inode->file_len);
+    hodo_unlock_inode(target_inode);
+    hodo_free_block(target_hodo_inode);
     return written_size;
 }
 
-
-/*-------------------------------------------------------------lookup용 함수----------------------------------------------------------------------------------*/
-uint64_t find_inode_number(struct hodo_inode *dir_hodo_inode, const char *target_name) {
+/*-------------------------------------------------------------truncate용 함수-------------------------------------------------------------------------------*/
+//일반 파일의 크기를 new_size로 바꾼다. 줄어드는 경우 new_size 뒤의 데이터블록과 비게 된 extent leaf를 모두 풀어주고,
+//마지막 블록에서 new_size 뒤쪽은 0으로 채워 다시 쓴다. 그래야 나중에 파일을 다시 늘렸을 때 그 부분이 0으로 읽힌다.
+int hodo_truncate_file(struct hodo_inode *file_inode, uint64_t new_size) {
     // ZONEFS_TRACE();
 
-    uint64_t result;
-    struct hodo_datablock *buf_block = kmalloc(HODO_DATABLOCK_SIZE, GFP_KERNEL);
+    if (new_size > (uint64_t)HODO_MAX_FILE_BLOCKS * HODO_FILE_BLOCK_SIZE)
+        return -EFBIG;
 
-    if (buf_block == NULL) {
-        // pr_info("zonefs: (error in hodo_sub_lookup) cannot allocate 4KB heap space for datablock variable\n");
-        return NOTHING_FOUND;
+    if (new_size < file_inode->file_len) {
+        uint32_t first_free_block = DIV_ROUND_UP(new_size, HODO_FILE_BLOCK_SIZE);
+        uint32_t offset_in_block = new_size % HODO_FILE_BLOCK_SIZE;
+        int ret;
+
+        //마지막 블록을 먼저 0으로 채운다. 새 논리 번호를 받지 못해 실패하면 파일은 그대로이다.
+        if (offset_in_block != 0) {
+            ret = hodo_zero_in_block(file_inode, first_free_block - 1, offset_in_block, HODO_FILE_BLOCK_SIZE - offset_in_block);
+            if (ret < 0)
+                return ret;
+        }
+
+        ret = hodo_extent_truncate(file_inode, first_free_block);
+        if (ret < 0)
+            return ret;
     }
 
-    //direct data block들에서 특정 이름의 hodo dentry를 찾아보기
-    logical_block_number_t direct_block_logical_number;
+    //늘어나는 경우에는 늘어난 부분이 모두 구멍이므로 길이만 바꾸면 된다
+    file_inode->file_len = new_size;
+    hodo_write_inode(file_inode);
 
-    for (int i = 0; i < 10; i++) {
-        direct_block_logical_number = dir_hodo_inode->direct[i];
-        
-        if(is_block_logical_number_valid(direct_block_logical_number)) {
-            hodo_read_struct(direct_block_logical_number, buf_block, HODO_DATABLOCK_SIZE);
+    return 0;
+}
 
-            result = find_inode_number_from_direct_block(buf_block, target_name);
+//file_block번째 블록의 offset_in_block부터 len바이트를 0으로 채워 같은 논리 번호에 다시 쓴다. 구멍이라면 이미 0이므로 그대로 둔다.
+static int hodo_zero_in_block(struct hodo_inode *file_inode, uint32_t file_block, uint32_t offset_in_block, uint32_t len) {
+    uint32_t extent_len;
+    logical_block_number_t logical_block_number = hodo_extent_lookup(file_inode, file_block, &extent_len);
+    int new_logical_number = 0;
+    int ret = 0;
 
-            if (result != NOTHING_FOUND) {
-                kfree(buf_block);
-                return result;
-            }
-        }
-    }
+    if (!is_block_logical_number_valid(logical_block_number))
+        return 0;
 
-    //single, double, triple indirect data block에서 특정 이름의 hodo dentry를 찾아보기
-    logical_block_number_t indirect_block_logical_number[3] = {
-        dir_hodo_inode->single_indirect,
-        dir_hodo_inode->double_indirect,
-        dir_hodo_inode->triple_indirect
-    };
+    //나눠 쓰는 블록이라면 이 파일만 새 논리 번호로 옮겨 쓴다. 번호를 먼저 받아 두어, 받지 못했다면 아무것도 바꾸지 않는다.
+    if (hodo_is_block_shared(logical_block_number)) {
+        new_logical_number = hodo_get_next_logical_number();
+        if (new_logical_number < 0)
+            return new_logical_number;
+    }
 
-    for(int i = 0; i < 3; i++){
-        if(is_block_logical_number_valid(indirect_block_logical_number[i])) {
-            hodo_read_struct(indirect_block_logical_number[i], buf_block, HODO_DATABLOCK_SIZE);
+    char *block = hodo_alloc_block();
 
-            result = find_inode_number_from_indirect_block(buf_block, target_name);
+    hodo_read_struct(logical_block_number, block, HODO_FILE_BLOCK_SIZE);
+    memset(block + offset_in_block, 0, len);
 
-            if (result != NOTHING_FOUND) {
-                kfree(buf_block);
-                return result;
-            }
-        }
+    if (new_logical_number) {
+        hodo_extent_remove_range(file_inode, file_block, file_block + 1);
+        logical_block_number = new_logical_number;
+        hodo_write_struct(block, HODO_FILE_BLOCK_SIZE, &logical_block_number);
+        ret = hodo_extent_insert(file_inode, file_block, logical_block_number);
+    }
+    else {
+        hodo_write_struct(block, HODO_FILE_BLOCK_SIZE, &logical_block_number);
     }
 
-    //모두 다 뒤져보았지만 찾는데 실패한 경우
-    kfree(buf_block);
-    return NOTHING_FOUND;
+    hodo_free_block(block);
+    return ret;
 }
 
-uint64_t find_inode_number_from_direct_block(
-    struct hodo_datablock* direct_block,
-    const char *target_name
-) {
+/*-------------------------------------------------------------fallocate용 함수-------------------------------------------------------------------------------*/
+//fallocate는 데이터를 쓰지 않고 extent만 고친다. 블록을 통째로 비우는 부분은 논리 번호를 풀어주기만 하고,
+//블록의 일부만 걸치는 양 끝만 0으로 채워 다시 쓴다.
+
+//[offset, offset + len)을 구멍으로 만든다
+int hodo_punch_hole(struct hodo_inode *file_inode, uint64_t offset, uint64_t len) {
     // ZONEFS_TRACE();
 
-    for (int j = HODO_DATA_START; j < HODO_DATABLOCK_SIZE - sizeof(struct hodo_dirent); j += sizeof(struct hodo_dirent)) {
-        struct hodo_dirent temp_dirent;
-        memcpy(&temp_dirent, (void*)direct_block + j, sizeof(struct hodo_dirent));
+    uint64_t end = min_t(uint64_t, offset + len, file_inode->file_len);
+    if (offset >= end)
+        return 0;
 
-        if (memcmp(temp_dirent.name, target_name, HODO_MAX_NAME_LEN) == 0)
-            return temp_dirent.i_ino;
+    uint32_t first_block = DIV_ROUND_UP(offset, HODO_FILE_BLOCK_SIZE);
+    uint32_t end_block = end / HODO_FILE_BLOCK_SIZE;
+
+    int ret = 0;
+
+    //범위가 한 블록 안에 들어간다면 그 부분만 0으로 채운다. 나눠 쓰던 블록이었다면 extent가 바뀌므로 아이노드도 쓴다.
+    if (offset / HODO_FILE_BLOCK_SIZE == (end - 1) / HODO_FILE_BLOCK_SIZE && (offset % HODO_FILE_BLOCK_SIZE || end % HODO_FILE_BLOCK_SIZE)) {
+        ret = hodo_zero_in_block(file_inode, offset / HODO_FILE_BLOCK_SIZE, offset % HODO_FILE_BLOCK_SIZE, end - offset);
+        hodo_write_inode(file_inode);
+        return ret;
     }
 
-    return NOTHING_FOUND;
+    if (offset % HODO_FILE_BLOCK_SIZE)
+        ret = hodo_zero_in_block(file_inode, first_block - 1, offset % HODO_FILE_BLOCK_SIZE, HODO_FILE_BLOCK_SIZE - offset % HODO_FILE_BLOCK_SIZE);
+    if (!ret && end % HODO_FILE_BLOCK_SIZE)
+        ret = hodo_zero_in_block(file_inode, end_block, 0, end % HODO_FILE_BLOCK_SIZE);
+
+    if (!ret && first_block < end_block)
+        ret = hodo_extent_remove_range(file_inode, first_block, end_block);
+
+    hodo_write_inode(file_inode);
+    return ret;
 }
 
-uint64_t find_inode_number_from_indirect_block(
-    struct hodo_datablock *indirect_block,
-    const char *target_name
-) {
+//[offset, offset + len)을 파일에서 들어내고 뒤의 블록들을 당겨온다. offset과 len은 블록 단위로 정렬되어 있어야 한다.
+int hodo_collapse_range(struct hodo_inode *file_inode, uint64_t offset, uint64_t len) {
     // ZONEFS_TRACE();
 
-    logical_block_number_t temp_block_logical_number;
-    struct hodo_datablock *temp_block = kmalloc(HODO_DATABLOCK_SIZE, GFP_KERNEL);
+    uint32_t first_block = offset / HODO_FILE_BLOCK_SIZE;
+    uint32_t end_block = (offset + len) / HODO_FILE_BLOCK_SIZE;
 
-    if (temp_block == NULL) {
-        // pr_info("zonefs: (error in hodo_sub_lookup) cannot allocate 4KB heap space for datablock variable\n");
-        return NOTHING_FOUND;
-    }
+    int ret = hodo_extent_remove_range(file_inode, first_block, end_block);
+    if (ret < 0)
+        return ret;
 
-    for (int j = HODO_DATA_START; j < HODO_DATABLOCK_SIZE - BLOCK_PTR_SZ; j += BLOCK_PTR_SZ) {
-        memcpy(&temp_block_logical_number, (void*)indirect_block + j, BLOCK_PTR_SZ);
+    ret = hodo_extent_shift(file_inode, end_block, -(int64_t)(end_block - first_block));
+    if (ret < 0)
+        return ret;
 
-        if(!is_block_logical_number_valid(temp_block_logical_number))
-            continue;
+    file_inode->file_len -= len;
+    hodo_write_inode(file_inode);
+    return 0;
+}
 
-        hodo_read_struct(temp_block_logical_number, temp_block, HODO_DATABLOCK_SIZE);
+//offset에 len바이트 크기의 구멍을 끼워 넣고 뒤의 블록들을 밀어낸다. offset과 len은 블록 단위로 정렬되어 있어야 한다.
+int hodo_insert_range(struct hodo_inode *file_inode, uint64_t offset, uint64_t len) {
+    // ZONEFS_TRACE();
 
-        uint64_t result;
+    uint32_t first_block = offset / HODO_FILE_BLOCK_SIZE;
 
-        if(is_directblock(temp_block))
-            result = find_inode_number_from_direct_block(temp_block, target_name);
+    int ret = hodo_extent_shift(file_inode, first_block, len / HODO_FILE_BLOCK_SIZE);
+    if (ret < 0)
+        return ret;
 
-        else 
-            result = find_inode_number_from_indirect_block(temp_block, target_name);
+    file_inode->file_len += len;
+    hodo_write_inode(file_inode);
+    return 0;
+}
 
-        if (result != NOTHING_FOUND){
-            kfree(temp_block);
-            return result;
-        }
+//[offset, offset + len)에 아직 데이터블록이 없는 만큼 빈 공간과 빈 논리 번호가 남아 있는지 확인한다.
+//블록의 물리 위치는 쓰는 순간 wp에서 정해지므로, 미리 자리를 잡아 두지는 않는다.
+int hodo_check_preallocation(struct hodo_inode *file_inode, uint64_t offset, uint64_t len) {
+    // ZONEFS_TRACE();
+
+    uint32_t file_block = offset / HODO_FILE_BLOCK_SIZE;
+    uint32_t end_block = DIV_ROUND_UP(offset + len, HODO_FILE_BLOCK_SIZE);
+    uint64_t nr_holes = 0;
+    struct kstatfs buf;
+
+    while (file_block < end_block) {
+        uint32_t extent_len;
+        logical_block_number_t logical_block_number = hodo_extent_lookup(file_inode, file_block, &extent_len);
+        uint32_t nr_blocks = min_t(uint32_t, extent_len, end_block - file_block);
+
+        if (nr_blocks == 0)
+            break;
+        if (!is_block_logical_number_valid(logical_block_number))
+            nr_holes += nr_blocks;
+        file_block += nr_blocks;
     }
 
-    kfree(temp_block);
-    return NOTHING_FOUND;
+    if (hodo_fill_statfs(&buf) < 0)
+        return -EAGAIN;
+
+    if (nr_holes > buf.f_bavail || nr_holes > buf.f_ffree)
+        return -ENOSPC;
+
+    return 0;
 }
 
-/*-------------------------------------------------------------readdir용 함수-------------------------------------------------------------------------------*/
-int read_all_dirents(
-    struct hodo_inode *dir_hodo_inode, 
-    struct dir_context *ctx, 
-    uint64_t *dirent_count
-) {
+/*-------------------------------------------------------------reflink용 함수-------------------------------------------------------------------------------*/
+//src의 파일 블록 src_block부터 nr_blocks개를 dst의 dst_block부터에 공유시킨다. 데이터블록은 읽지도 쓰지도 않고
+//extent와 공유 수만 고친다. src와 dst가 같은 파일이라면 같은 hodo_inode를 넘긴다.
+//공유 수를 모두 올릴 수 있는지 먼저 확인하므로 -EMLINK라면 아무것도 바뀌지 않는다. dst에 원래 있던 블록은 그 뒤에 풀어준다.
+//extent를 더하다가 실패하면 범위의 남은 부분은 구멍으로 남으므로, 성공하지 못했더라도 호출한 쪽이 dst를 지금 상태 그대로 써야 한다.
+int hodo_clone_range(struct hodo_inode *src, uint32_t src_block, struct hodo_inode *dst, uint32_t dst_block, uint32_t nr_blocks) {
     // ZONEFS_TRACE();
 
-    struct hodo_datablock *buf_block = kmalloc(HODO_DATABLOCK_SIZE, GFP_KERNEL);
+    uint32_t done = 0;
+    int ret;
 
-    if (buf_block == NULL) {
-        // pr_info("zonefs: (error in hodo_sub_readdir) cannot allocate 4KB heap space for datablock variable\n");
-        return END_READ;
+    //dst를 건드리기 전에 범위의 모든 블록에 공유 수를 올려 둔다. 한 run이라도 더 나눌 수 없다면 올린 것을 되돌린다.
+    while (done < nr_blocks) {
+        uint32_t extent_len;
+        logical_block_number_t logical_block_number = hodo_extent_lookup(src, src_block + done, &extent_len);
+        uint32_t run = min_t(uint32_t, extent_len, nr_blocks - done);
+
+        if (run == 0)
+            break;
+
+        if (is_block_logical_number_valid(logical_block_number) && !hodo_get_shared_range(logical_block_number, run)) {
+            hodo_clone_unshare(src, src_block, done);
+            return -EMLINK;
+        }
+
+        done += run;
     }
+    nr_blocks = done;
 
-    int result;
+    ret = hodo_extent_remove_range(dst, dst_block, dst_block + nr_blocks);
+    if (ret < 0) {
+        hodo_clone_unshare(src, src_block, nr_blocks);
+        return ret;
+    }
 
-    //direct data block들에서 hodo dirent들을 읽어내기
-    logical_block_number_t direct_block_logical_number;
+    done = 0;
+    while (done < nr_blocks) {
+        uint32_t extent_len;
+        logical_block_number_t logical_block_number = hodo_extent_lookup(src, src_block + done, &extent_len);
+        uint32_t run = min_t(uint32_t, extent_len, nr_blocks - done);
 
-    for (int i = 0; i < 10; i++) {
-        direct_block_logical_number = dir_hodo_inode->direct[i];
-        
-        if(is_block_logical_number_valid(direct_block_logical_number)) {
-            hodo_read_struct(direct_block_logical_number, buf_block, HODO_DATABLOCK_SIZE);
-
-            result = read_all_dirents_from_direct_block(buf_block, ctx, dirent_count);
-            
-            if(result == END_READ) {
-                kfree(buf_block);
-                return result;
+        //구멍은 dst에서도 구멍으로 남는다
+        if (is_block_logical_number_valid(logical_block_number)) {
+            ret = hodo_extent_insert_range(dst, dst_block + done, logical_block_number, run);
+            if (ret < 0) {
+                //아직 dst에 붙지 못한 블록들의 공유 수만 되돌린다. 이미 붙은 블록들은 dst의 것으로 남는다.
+                hodo_clone_unshare(src, src_block + done, nr_blocks - done);
+                return ret;
             }
         }
+
+        done += run;
     }
 
-    //single, double, triple indirect data block에서 hodo dirent들을 읽어내기
-    logical_block_number_t indirect_block_logical_number[3] = {
-        dir_hodo_inode->single_indirect,
-        dir_hodo_inode->double_indirect,
-        dir_hodo_inode->triple_indirect
-    };
+    return 0;
+}
 
-    for(int i = 0; i < 3; i++){
-        if(is_block_logical_number_valid(indirect_block_logical_number[i])) {
-            hodo_read_struct(indirect_block_logical_number[i], buf_block, HODO_DATABLOCK_SIZE);
+//hodo_clone_range가 src의 파일 블록 src_block부터 nr_blocks개에 올려 둔 공유 수를 되돌린다
+static void hodo_clone_unshare(struct hodo_inode *src, uint32_t src_block, uint32_t nr_blocks) {
+    uint32_t done = 0;
 
-            result = read_all_dirents_from_indirect_block(buf_block, ctx, dirent_count);
+    while (done < nr_blocks) {
+        uint32_t extent_len;
+        logical_block_number_t logical_block_number = hodo_extent_lookup(src, src_block + done, &extent_len);
+        uint32_t run = min_t(uint32_t, extent_len, nr_blocks - done);
 
-            if(result == END_READ) {
-                kfree(buf_block);
-                return result;
-            }
+        if (run == 0)
+            break;
+
+        //공유 수를 올려 두었으므로 블록이 풀리지는 않고 공유 수만 줄어든다
+        if (is_block_logical_number_valid(logical_block_number))
+            hodo_release_logical_range(logical_block_number, run);
+
+        done += run;
+    }
+}
+
+/*-------------------------------------------------------------extent용 함수-------------------------------------------------------------------------------*/
+//일반 파일의 데이터블록 위치는 (파일 블록 번호 -> 논리 번호, 길이) extent로 관리한다.
+//extent가 HODO_INODE_EXTENT_COUNT개를 넘으면 extent들을 extent leaf block으로 옮기고, hodo_inode에는 leaf들의 index만 남긴다.
+logical_block_number_t hodo_extent_lookup(struct hodo_inode *file_inode, uint32_t file_block, uint32_t *out_len) {
+    // ZONEFS_TRACE();
+
+    struct hodo_extent *extent = file_inode->i_extent;
+    int count = file_inode->i_extent_count;
+    uint32_t next_boundary = HODO_MAX_FILE_BLOCKS;
+    struct hodo_extent_leaf *leaf = NULL;
+    logical_block_number_t result = 0;
+
+    if (file_inode->i_extent_depth > 0) {
+        int index = hodo_extent_search(file_inode->i_extent, count, file_block);
+        if (index < 0) {
+            *out_len = (count > 0) ? file_inode->i_extent[0].e_block - file_block : HODO_MAX_FILE_BLOCKS - file_block;
+            return 0;
+        }
+
+        if (index + 1 < count)
+            next_boundary = file_inode->i_extent[index + 1].e_block;
+
+        //이어지는 파일 블록들은 대개 같은 leaf에 있으므로, leaf를 복사하지 않고 cache 안에서 바로 찾는다
+        mutex_lock(&hodo_leaf_cache_lock);
+        leaf = hodo_leaf_cache_get(file_inode->i_extent[index].e_start);
+        if (leaf == NULL) {
+            mutex_unlock(&hodo_leaf_cache_lock);
+            *out_len = 0;
+            return 0;
         }
+
+        extent = leaf->extent;
+        count = leaf->count;
     }
 
-    //모두 잘 다 뒤져보았으므로 더 읽을 필요가 없음을 알려주기 위해 END_READ를 반환하고 끝낸다
-    kfree(buf_block);
-    return END_READ;
+    int i = hodo_extent_search(extent, count, file_block);
+
+    if (i >= 0 && file_block - extent[i].e_block < extent[i].e_len) {
+        //extent 안의 블록이라면 extent 끝까지는 논리 번호가 연속이다
+        *out_len = extent[i].e_len - (file_block - extent[i].e_block);
+        result = extent[i].e_start + (file_block - extent[i].e_block);
+    }
+    else {
+        //구멍이라면 다음 extent가 시작하기 전까지가 구멍이다
+        uint32_t hole_end = (i + 1 < count) ? extent[i + 1].e_block : next_boundary;
+        *out_len = hole_end - file_block;
+    }
+
+    if (leaf)
+        mutex_unlock(&hodo_leaf_cache_lock);
+    return result;
 }
 
-int read_all_dirents_from_direct_block(
-    struct hodo_datablock* direct_block,
-    struct dir_context *ctx,
-    uint64_t *dirent_count
-) {
+//비어 있던 파일 블록 file_block에 논리 번호 logical_block_number를 붙인다. 바뀐 hodo_inode는 호출한 쪽에서 쓴다.
+int hodo_extent_insert(struct hodo_inode *file_inode, uint32_t file_block, logical_block_number_t logical_block_number) {
+    return hodo_extent_insert_range(file_inode, file_block, logical_block_number, 1);
+}
+
+//구멍인 파일 블록 file_block부터 len개가 논리 번호 logical_block_number부터 연속으로 놓이도록 extent를 더한다.
+//범위가 여러 leaf에 걸치면 leaf마다 나누어 더하므로, 블록 수와 상관없이 고쳐 쓰는 leaf는 걸친 leaf들뿐이다.
+int hodo_extent_insert_range(struct hodo_inode *file_inode, uint32_t file_block, logical_block_number_t logical_block_number, uint32_t len) {
     // ZONEFS_TRACE();
 
-    for (int j = HODO_DATA_START; j < HODO_DATABLOCK_SIZE - sizeof(struct hodo_dirent); j += sizeof(struct hodo_dirent)) {
-        struct hodo_dirent temp_dirent;
-        memcpy(&temp_dirent, (void*)direct_block + j, sizeof(struct hodo_dirent));
-        
-        if(is_dirent_valid(&temp_dirent)) {
-            if(*dirent_count == ctx->pos) {
-                hodo_dir_emit(ctx, &temp_dirent);
-                ctx->pos++;
-            }
+    if (file_inode->i_extent_depth == 0) {
+        int count = file_inode->i_extent_count;
 
-            (*dirent_count)++;
+        if (hodo_extent_array_insert(file_inode->i_extent, &count, HODO_INODE_EXTENT_COUNT, file_block, logical_block_number, len) == 0) {
+            file_inode->i_extent_count = count;
+            return 0;
         }
+
+        //hodo_inode 안의 extent가 가득 찼다면 leaf block으로 옮기고 한 단계 깊게 만든다
+        int ret = hodo_extent_grow_depth(file_inode);
+        if (ret < 0)
+            return ret;
     }
 
-    return !END_READ;
+    struct hodo_extent_leaf *leaf = hodo_alloc_block();
+    if (leaf == NULL)
+        return -ENOMEM;
+
+    while (len > 0) {
+        int index = hodo_extent_search(file_inode->i_extent, file_inode->i_extent_count, file_block);
+        if (index < 0)
+            index = 0;
+
+        uint32_t leaf_end = (index + 1 < file_inode->i_extent_count) ? file_inode->i_extent[index + 1].e_block : HODO_MAX_FILE_BLOCKS;
+        uint32_t nr_blocks = min_t(uint32_t, len, leaf_end - file_block);
+
+        if (hodo_read_extent_leaf(file_inode->i_extent[index].e_start, leaf) < 0) {
+            hodo_free_block(leaf);
+            return -EIO;
+        }
+
+        int count = leaf->count;
+        if (hodo_extent_array_insert(leaf->extent, &count, HODO_LEAF_EXTENT_COUNT, file_block, logical_block_number, nr_blocks) < 0) {
+            //leaf가 가득 찼다면 반으로 나누어 뒤쪽 절반을 새 leaf로 옮기고, 들어갈 leaf를 다시 찾는다
+            int ret = hodo_extent_split_leaf(file_inode, index, leaf);
+            if (ret < 0) {
+                hodo_free_block(leaf);
+                return ret;
+            }
+            continue;
+        }
+        leaf->count = count;
+
+        //leaf는 같은 논리 번호에 다시 쓰므로 index는 바뀌지 않는다
+        hodo_write_extent_leaf(leaf, &file_inode->i_extent[index].e_start);
+
+        file_block += nr_blocks;
+        logical_block_number += nr_blocks;
+        len -= nr_blocks;
+    }
+
+    hodo_free_block(leaf);
+    return 0;
 }
 
-int read_all_dirents_from_indirect_block(
-    struct hodo_datablock* indirect_block,
-    struct dir_context *ctx,
-    uint64_t *dirent_count
-) {
+//파일 블록 file_block부터 뒤의 데이터블록을 모두 풀어주고 extent tree를 그만큼 줄인다
+int hodo_extent_truncate(struct hodo_inode *file_inode, uint32_t file_block) {
     // ZONEFS_TRACE();
 
-    logical_block_number_t temp_block_logical_number;
-    struct hodo_datablock *temp_block = kmalloc(HODO_DATABLOCK_SIZE, GFP_KERNEL);
+    if (file_inode->i_extent_depth == 0) {
+        int count = file_inode->i_extent_count;
 
-     if (temp_block == NULL) {
-        // pr_info("zonefs: (error in hodo_sub_readdir) cannot allocate 4KB heap space for datablock variable\n");
+        hodo_extent_array_truncate(file_inode->i_extent, &count, file_block);
+        file_inode->i_extent_count = count;
         return 0;
     }
 
-    for (int j = HODO_DATA_START; j < HODO_DATABLOCK_SIZE - BLOCK_PTR_SZ; j += BLOCK_PTR_SZ) {
-        memcpy(&temp_block_logical_number, (void*)indirect_block + j, BLOCK_PTR_SZ);
+    struct hodo_extent_leaf *leaf = hodo_alloc_block();
+    if (leaf == NULL)
+        return -ENOMEM;
 
-        if(!is_block_logical_number_valid(temp_block_logical_number))
-            continue;
+    //file_block 뒤에서 시작하는 leaf는 안의 블록들과 함께 통째로 풀어준다. 첫 leaf는 파일 블록 0부터를 담당하므로 항상 남긴다.
+    while (file_inode->i_extent_count > 1 && file_inode->i_extent[file_inode->i_extent_count - 1].e_block >= file_block) {
+        struct hodo_extent *index = &file_inode->i_extent[file_inode->i_extent_count - 1];
 
-        hodo_read_struct(temp_block_logical_number, temp_block, HODO_DATABLOCK_SIZE);
+        if (hodo_read_extent_leaf(index->e_start, leaf) < 0) {
+            hodo_free_block(leaf);
+            return -EIO;
+        }
 
-        uint64_t result;
+        for (uint32_t i = 0; i < leaf->count; i++)
+            hodo_release_logical_range(leaf->extent[i].e_start, leaf->extent[i].e_len);
 
-        if(is_directblock(temp_block))
-            result = read_all_dirents_from_direct_block(temp_block, ctx, dirent_count);
+        hodo_drop_physical_block(index->e_start);
+        hodo_erase_table_entry(index->e_start);
 
-        else 
-            result = read_all_dirents_from_indirect_block(temp_block, ctx, dirent_count);
+        memset(index, 0, sizeof(struct hodo_extent));
+        file_inode->i_extent_count--;
+    }
 
-        if (result == END_READ){
-            kfree(temp_block);
-            return result;
-        }
+    //file_block이 걸쳐 있는 마지막 leaf는 잘라서 같은 논리 번호에 다시 쓴다
+    struct hodo_extent *index = &file_inode->i_extent[file_inode->i_extent_count - 1];
+
+    if (hodo_read_extent_leaf(index->e_start, leaf) < 0) {
+        hodo_free_block(leaf);
+        return -EIO;
     }
 
-    kfree(temp_block);
-    return !END_READ;
-}
+    int count = leaf->count;
+    if (hodo_extent_array_truncate(leaf->extent, &count, file_block)) {
+        leaf->count = count;
+        hodo_write_extent_leaf(leaf, &index->e_start);
+    }
 
-static bool hodo_dir_emit(struct dir_context *ctx, struct hodo_dirent *temp_dirent){
-    return dir_emit(
-                    ctx,
-                    temp_dirent->name,
-                    temp_dirent->name_len,
-                    temp_dirent->i_ino,
-                    ((temp_dirent->file_type == HODO_TYPE_DIR) ? DT_DIR : DT_REG)
-    );
+    //leaf가 하나만 남았고 그 extent들이 hodo_inode 안에 들어간다면 leaf를 없애고 depth 0으로 되돌린다
+    if (file_inode->i_extent_count == 1 && leaf->count <= HODO_INODE_EXTENT_COUNT) {
+        logical_block_number_t leaf_logical_number = index->e_start;
+
+        memset(file_inode->i_extent, 0, sizeof(file_inode->i_extent));
+        memcpy(file_inode->i_extent, leaf->extent, leaf->count * sizeof(struct hodo_extent));
+        file_inode->i_extent_count = leaf->count;
+        file_inode->i_extent_depth = 0;
+
+        hodo_drop_physical_block(leaf_logical_number);
+        hodo_erase_table_entry(leaf_logical_number);
+    }
+
+    hodo_free_block(leaf);
+    return 0;
 }
 
-/*-------------------------------------------------------------create용 함수-------------------------------------------------------------------------------*/
-int add_dirent(struct inode* dir, struct hodo_inode* sub_inode) {
+//파일 블록 [start, end)의 데이터블록들을 풀어주고 extent tree에서 지운다. 걸쳐 있는 extent는 잘라내거나 둘로 나눈다.
+int hodo_extent_remove_range(struct hodo_inode *file_inode, uint32_t start, uint32_t end) {
     // ZONEFS_TRACE();
 
-    // read directory inode
-    logical_block_number_t dir_block_logical_number = dir->i_ino;
-    struct hodo_inode dir_inode = {0,};
+    if (file_inode->i_extent_depth == 0) {
+        int count = file_inode->i_extent_count;
+        int ret = hodo_extent_array_remove(file_inode->i_extent, &count, HODO_INODE_EXTENT_COUNT, start, end);
 
-    hodo_read_struct(dir_block_logical_number, &dir_inode, sizeof(struct hodo_inode));
+        if (ret != -ENOSPC) {
+            file_inode->i_extent_count = count;
+            return ret < 0 ? ret : 0;
+        }
 
-    struct hodo_datablock* temp_datablock = kmalloc(HODO_DATABLOCK_SIZE, GFP_KERNEL);
+        //extent를 둘로 나눌 자리가 없다면 leaf block으로 옮기고 한 단계 깊게 만든다
+        ret = hodo_extent_grow_depth(file_inode);
+        if (ret < 0)
+            return ret;
+    }
 
-    for (int i = 0; i < 10; ++i) {
-        // pr_info("%dth data block\n", i);
-        if (dir_inode.direct[i] != 0) {
-            logical_block_number_t temp_logical_number = dir_inode.direct[i];
-            hodo_read_struct(temp_logical_number, temp_datablock, sizeof(struct hodo_datablock));
+    struct hodo_extent_leaf *leaf = hodo_alloc_block();
+    if (leaf == NULL)
+        return -ENOMEM;
 
-            for (int j = HODO_DATA_START; j < HODO_DATABLOCK_SIZE - sizeof(struct hodo_dirent); j += sizeof(struct hodo_dirent)) {
-                struct hodo_dirent temp_dirent;
-                memcpy(&temp_dirent, (void*)temp_datablock + j, sizeof(struct hodo_dirent));
-                
-                if(is_dirent_valid(&temp_dirent)) {
-                    continue; 
-                }
-                else {
-                    memcpy(temp_dirent.name, sub_inode->name, sub_inode->name_len);
-                    temp_dirent.name_len = sub_inode->name_len;
-                    temp_dirent.i_ino = sub_inode->i_ino;
-                    temp_dirent.file_type = sub_inode->type;
+    for (int index = 0; index < file_inode->i_extent_count; index++) {
+        uint32_t leaf_start = file_inode->i_extent[index].e_block;
+        uint32_t leaf_end = (index + 1 < file_inode->i_extent_count) ? file_inode->i_extent[index + 1].e_block : HODO_MAX_FILE_BLOCKS;
 
-                    memcpy((void*)temp_datablock + j, &temp_dirent, sizeof(struct hodo_dirent));
+        if (leaf_end <= start || leaf_start >= end)
+            continue;
 
-                    dir_inode.file_len++;
-                    hodo_write_struct(temp_datablock, sizeof(struct hodo_datablock), &temp_logical_number);
+        if (hodo_read_extent_leaf(file_inode->i_extent[index].e_start, leaf) < 0) {
+            hodo_free_block(leaf);
+            return -EIO;
+        }
 
-                    hodo_write_struct(&dir_inode, sizeof(struct hodo_inode), &dir_block_logical_number);
+        int count = leaf->count;
+        int ret = hodo_extent_array_remove(leaf->extent, &count, HODO_LEAF_EXTENT_COUNT, start, end);
 
-                    kfree(temp_datablock);
-                    return 0;
-                }
+        //leaf가 가득 차서 extent를 나눌 수 없다면 leaf부터 둘로 나누고 이 index를 다시 본다
+        if (ret == -ENOSPC) {
+            ret = hodo_extent_split_leaf(file_inode, index, leaf);
+            if (ret < 0) {
+                hodo_free_block(leaf);
+                return ret;
             }
+            index--;
+            continue;
         }
-        else {
-            struct hodo_dirent temp_dirent;
-            memcpy(temp_dirent.name, sub_inode->name, sub_inode->name_len);
-            temp_dirent.name_len = sub_inode->name_len;
-            temp_dirent.i_ino = sub_inode->i_ino;
-            temp_dirent.file_type = sub_inode->type;
-
-            memset(temp_datablock, 0, HODO_DATABLOCK_SIZE);
-            temp_datablock->magic[0] = 'D';
-            temp_datablock->magic[1] = 'A';
-            temp_datablock->magic[2] = 'T';
-            temp_datablock->magic[3] = '0';
 
-            memcpy((void*)temp_datablock + HODO_DATA_START, &temp_dirent, sizeof(struct hodo_dirent));
+        leaf->count = count;
 
-            dir_inode.file_len++;
-            logical_block_number_t temp_logical_number = 0;
-            hodo_write_struct(temp_datablock, sizeof(struct hodo_datablock), &temp_logical_number);
+        //비게 된 leaf는 풀어주고 index에서 뺀다. 그 범위는 앞 leaf가 이어받으며, 앞 leaf에는 그 범위의 extent가 없으므로 구멍으로 읽힌다.
+        if (count == 0 && index > 0) {
+            logical_block_number_t leaf_logical_number = file_inode->i_extent[index].e_start;
 
-            dir_inode.direct[i] = temp_logical_number;
-            hodo_write_struct(&dir_inode, sizeof(struct hodo_inode), &dir_block_logical_number);
+            hodo_drop_physical_block(leaf_logical_number);
+            hodo_erase_table_entry(leaf_logical_number);
 
-            kfree(temp_datablock);
-            return 0;
+            memmove(&file_inode->i_extent[index], &file_inode->i_extent[index + 1], (file_inode->i_extent_count - index - 1) * sizeof(struct hodo_extent));
+            file_inode->i_extent_count--;
+            memset(&file_inode->i_extent[file_inode->i_extent_count], 0, sizeof(struct hodo_extent));
+            index--;
+            continue;
         }
+
+        if (ret > 0)
+            hodo_write_extent_leaf(leaf, &file_inode->i_extent[index].e_start);
     }
 
-    kfree(temp_datablock);
-    return -1;
+    hodo_free_block(leaf);
+    return 0;
 }
 
-/*-------------------------------------------------------------unlink용 함수-------------------------------------------------------------------------------*/
-int remove_dirent(struct hodo_inode *dir_hodo_inode, struct inode *dir, const char *target_name, logical_block_number_t *out_logical_number){
+//from 이후의 파일 블록들을 delta만큼 옮긴다. 데이터블록은 그대로 두고 extent의 e_block만 고친다.
+//delta가 양수라면 from에 걸친 extent를 먼저 나누고, 음수라면 [from + delta, from)이 이미 비어 있어야 한다.
+int hodo_extent_shift(struct hodo_inode *file_inode, uint32_t from, int64_t delta) {
     // ZONEFS_TRACE();
 
-    struct hodo_datablock *buf_block = kmalloc(HODO_DATABLOCK_SIZE, GFP_KERNEL);
+    if (file_inode->i_extent_depth == 0) {
+        int count = file_inode->i_extent_count;
 
-    if (buf_block == NULL) {
-        // pr_info("zonefs: (error in hodo_unlink) cannot allocate 4KB heap space for datablock variable\n");
-        return NOTHING_FOUND;
-    }
+        if (delta > 0 && hodo_extent_array_split(file_inode->i_extent, &count, HODO_INODE_EXTENT_COUNT, from) < 0) {
+            int ret = hodo_extent_grow_depth(file_inode);
+            if (ret < 0)
+                return ret;
+            return hodo_extent_shift(file_inode, from, delta);
+        }
 
-    int result;
-    logical_block_number_t written_logical_number;
+        hodo_extent_array_shift(file_inode->i_extent, count, from, delta);
+        file_inode->i_extent_count = count;
+        return 0;
+    }
 
-    //direct data block에서 target_mapping_index를 가진 dirent를 찾아 지우기
-    logical_block_number_t direct_block_logical_number;
+    struct hodo_extent_leaf *leaf = hodo_alloc_block();
+    if (leaf == NULL)
+        return -ENOMEM;
 
-    for (int i = 0; i < 10; i++) {
-        direct_block_logical_number = dir_hodo_inode->direct[i];
-        
-        if(is_block_logical_number_valid(direct_block_logical_number)) {
-            hodo_read_struct(direct_block_logical_number, buf_block, HODO_DATABLOCK_SIZE);
+    uint32_t collapse_start = (delta < 0) ? from + delta : from;
 
-            written_logical_number = direct_block_logical_number;
-            result = remove_dirent_from_direct_block(buf_block, target_name, &written_logical_number);
-            
-            if(result != NOTHING_FOUND) {
-                //dirent를 삭제하면서 direct_datablock가 새로 써지므로, 이를 가리키는 hodo_inode는 새로 써져야 한다.
-                dir_hodo_inode->direct[i] = written_logical_number;
-                dir_hodo_inode->i_atime = current_time(dir);
-                dir_hodo_inode->i_mtime = current_time(dir);
-                dir_hodo_inode->i_ctime = current_time(dir);
-                
-                //dirent가 삭제되면서 예하 파일 수가 줄어들었으므로, 이를 반영한다
-                dir_hodo_inode->file_len--;
+    for (int index = 0; index < file_inode->i_extent_count; index++) {
+        uint32_t leaf_end = (index + 1 < file_inode->i_extent_count) ? file_inode->i_extent[index + 1].e_block : HODO_MAX_FILE_BLOCKS;
 
-                hodo_write_struct(dir_hodo_inode, sizeof(struct hodo_inode), out_logical_number);
+        //from 앞에서 끝나는 leaf에는 옮길 extent가 없다
+        if (leaf_end <= from)
+            continue;
 
+        if (hodo_read_extent_leaf(file_inode->i_extent[index].e_start, leaf) < 0) {
+            hodo_free_block(leaf);
+            return -EIO;
+        }
 
-                hodo_write_struct(dir_hodo_inode, sizeof(struct hodo_inode), out_logical_number);
+        int count = leaf->count;
 
-                kfree(buf_block);
-                return result;
+        if (delta > 0 && hodo_extent_array_split(leaf->extent, &count, HODO_LEAF_EXTENT_COUNT, from) < 0) {
+            int ret = hodo_extent_split_leaf(file_inode, index, leaf);
+            if (ret < 0) {
+                hodo_free_block(leaf);
+                return ret;
             }
+            index--;
+            continue;
         }
+
+        hodo_extent_array_shift(leaf->extent, count, from, delta);
+        leaf->count = count;
+        hodo_write_extent_leaf(leaf, &file_inode->i_extent[index].e_start);
     }
 
-    //single, double, triple indirect data block들이 가리키는 direct_data_block에서 target_mapping_index를 가진 dirent를 찾아 지우기
-    logical_block_number_t indirect_block_logical_number[3] = {
-        dir_hodo_inode->single_indirect,
-        dir_hodo_inode->double_indirect,
-        dir_hodo_inode->triple_indirect
-    };
+    //첫 index는 항상 파일 블록 0부터를 담당한다. 들어낸 범위 안에서 시작하던 leaf는 들어낸 범위의 시작부터 담당한다.
+    for (int index = 1; index < file_inode->i_extent_count; index++) {
+        uint32_t e_block = file_inode->i_extent[index].e_block;
 
-    for(int i = 0; i < 3; i++){
-        if(is_block_logical_number_valid(indirect_block_logical_number[i])) {
-            hodo_read_struct(indirect_block_logical_number[i], buf_block, HODO_DATABLOCK_SIZE);
+        if (e_block >= from)
+            file_inode->i_extent[index].e_block = e_block + delta;
+        else if (delta < 0 && e_block > collapse_start)
+            file_inode->i_extent[index].e_block = collapse_start;
+    }
 
-            written_logical_number = indirect_block_logical_number[i];
-            result = remove_dirent_from_indirect_block(buf_block, target_name, &written_logical_number);
+    hodo_free_block(leaf);
+    return 0;
+}
 
-            if(result != NOTHING_FOUND) {
-                //dirent를 삭제하면서 direct_datablock가 새로 써지고, 이를 가리키는 indirect_datablock도 새로 써지므로, 이를 가리키는 hodo_inode 또한 새로 써져야 한다.
-                indirect_block_logical_number[i] = written_logical_number;
-                dir_hodo_inode->i_atime = current_time(dir);
-                dir_hodo_inode->i_mtime = current_time(dir);
-                dir_hodo_inode->i_ctime = current_time(dir);
+//extent 배열에서 e_block이 file_block 이하인 마지막 extent를 찾는다. 없으면 -1을 반환한다.
+static int hodo_extent_search(struct hodo_extent *extent, int count, uint32_t file_block) {
+    int low = 0;
+    int high = count - 1;
+    int result = -1;
 
-                //dirent가 삭제되면서 예하 파일 수가 줄어들었으므로, 이를 반영한다
-                dir_hodo_inode->file_len--;
+    while (low <= high) {
+        int mid = low + (high - low) / 2;
 
-                hodo_write_struct(dir_hodo_inode, sizeof(struct hodo_inode), out_logical_number);
-                kfree(buf_block);
-                return result;
-            }
+        if (extent[mid].e_block <= file_block) {
+            result = mid;
+            low = mid + 1;
         }
+        else
+            high = mid - 1;
     }
 
-    //해당 이름의 dirent를 찾아서 삭제하지 못하였으므로
-    kfree(buf_block);
-    return NOTHING_FOUND;
+    return result;
 }
 
-int remove_dirent_from_direct_block(
-    struct hodo_datablock *direct_block,
-    const char *target_name,
-    logical_block_number_t *out_logical_number
-) {
-    // ZONEFS_TRACE();
+//extent 배열에 파일 블록 file_block부터 len개(논리 번호 logical_block_number부터 연속)를 더한다.
+//앞뒤 extent와 파일 블록도, 논리 번호도 이어진다면 새 extent를 만들지 않고 늘린다.
+static int hodo_extent_array_insert(struct hodo_extent *extent, int *count, int max_count, uint32_t file_block, logical_block_number_t logical_block_number, uint32_t len) {
+    int i = hodo_extent_search(extent, *count, file_block);
+
+    bool merge_prev = (i >= 0 &&
+        extent[i].e_block + extent[i].e_len == file_block &&
+        extent[i].e_start + extent[i].e_len == logical_block_number);
+    bool merge_next = (i + 1 < *count &&
+        extent[i + 1].e_block == file_block + len &&
+        extent[i + 1].e_start == logical_block_number + len);
+
+    if (merge_prev && merge_next) {
+        extent[i].e_len += len + extent[i + 1].e_len;
+        memmove(&extent[i + 1], &extent[i + 2], (*count - i - 2) * sizeof(struct hodo_extent));
+        (*count)--;
+        return 0;
+    }
 
-    for (int j = HODO_DATA_START; j < HODO_DATABLOCK_SIZE - sizeof(struct hodo_dirent); j += sizeof(struct hodo_dirent)) {
-        struct hodo_dirent temp_dirent;
-        memcpy(&temp_dirent, (void*)direct_block + j, sizeof(struct hodo_dirent));
+    if (merge_prev) {
+        extent[i].e_len += len;
+        return 0;
+    }
 
-        if (memcmp(temp_dirent.name, target_name, HODO_MAX_NAME_LEN) == 0){
-            compact_datablock(direct_block, j, sizeof(struct hodo_dirent), out_logical_number);
+    if (merge_next) {
+        extent[i + 1].e_block -= len;
+        extent[i + 1].e_start -= len;
+        extent[i + 1].e_len += len;
+        return 0;
+    }
 
-            return !NOTHING_FOUND;
-        }
+    if (*count >= max_count)
+        return -ENOSPC;
+
+    memmove(&extent[i + 2], &extent[i + 1], (*count - i - 1) * sizeof(struct hodo_extent));
+    extent[i + 1].e_block = file_block;
+    extent[i + 1].e_len = len;
+    extent[i + 1].e_start = logical_block_number;
+    (*count)++;
+
+    return 0;
+}
+
+//extent 배열에서 file_block부터 뒤의 블록들을 풀어준다. file_block에 걸친 extent는 앞부분만 남긴다. 바뀐 것이 있으면 true를 반환한다.
+static bool hodo_extent_array_truncate(struct hodo_extent *extent, int *count, uint32_t file_block) {
+    int i = *count;
+
+    while (i > 0 && extent[i - 1].e_block >= file_block) {
+        i--;
+        hodo_release_logical_range(extent[i].e_start, extent[i].e_len);
+    }
+
+    bool changed = (i != *count);
+    memset(&extent[i], 0, (*count - i) * sizeof(struct hodo_extent));
+    *count = i;
+
+    if (i > 0 && extent[i - 1].e_block + extent[i - 1].e_len > file_block) {
+        uint32_t keep_len = file_block - extent[i - 1].e_block;
+
+        hodo_release_logical_range(extent[i - 1].e_start + keep_len, extent[i - 1].e_len - keep_len);
+        extent[i - 1].e_len = keep_len;
+        changed = true;
     }
 
-    return NOTHING_FOUND;
+    return changed;
+}
+
+//extent 배열에서 파일 블록 [start, end)를 풀어준다. 범위가 extent 한가운데라면 extent를 둘로 나누는데,
+//배열에 자리가 없으면 아무것도 바꾸지 않고 -ENOSPC를 반환한다. 바뀐 것이 있으면 1, 없으면 0을 반환한다.
+static int hodo_extent_array_remove(struct hodo_extent *extent, int *count, int max_count, uint32_t start, uint32_t end) {
+    int changed = 0;
+
+    for (int i = 0; i < *count; i++) {
+        if (extent[i].e_block < start && extent[i].e_block + extent[i].e_len > end && *count >= max_count)
+            return -ENOSPC;
+    }
+
+    for (int i = 0; i < *count; i++) {
+        uint32_t e_block = extent[i].e_block;
+        uint32_t e_end = e_block + extent[i].e_len;
+
+        if (e_end <= start || e_block >= end)
+            continue;
+
+        uint32_t cut_start = max(e_block, start);
+        uint32_t cut_end = min(e_end, end);
+        logical_block_number_t e_start = extent[i].e_start;
+
+        hodo_release_logical_range(e_start + (cut_start - e_block), cut_end - cut_start);
+        changed = 1;
+
+        if (e_block < start && e_end > end) {
+            //가운데가 빠지므로 앞부분과 뒷부분 두 extent로 나눈다
+            memmove(&extent[i + 2], &extent[i + 1], (*count - i - 1) * sizeof(struct hodo_extent));
+            extent[i].e_len = start - e_block;
+            extent[i + 1].e_block = end;
+            extent[i + 1].e_len = e_end - end;
+            extent[i + 1].e_start = e_start + (end - e_block);
+            (*count)++;
+            i++;
+        }
+        else if (e_block < start) {
+            extent[i].e_len = start - e_block;
+        }
+        else if (e_end > end) {
+            extent[i].e_block = end;
+            extent[i].e_len = e_end - end;
+            extent[i].e_start = e_start + (end - e_block);
+        }
+        else {
+            memmove(&extent[i], &extent[i + 1], (*count - i - 1) * sizeof(struct hodo_extent));
+            (*count)--;
+            memset(&extent[*count], 0, sizeof(struct hodo_extent));
+            i--;
+        }
+    }
+
+    return changed;
+}
+
+//file_block이 어떤 extent의 한가운데라면 그 extent를 file_block 앞뒤 두 extent로 나눈다. 자리가 없으면 -ENOSPC를 반환한다.
+static int hodo_extent_array_split(struct hodo_extent *extent, int *count, int max_count, uint32_t file_block) {
+    int i = hodo_extent_search(extent, *count, file_block);
+
+    if (i < 0 || extent[i].e_block == file_block || file_block - extent[i].e_block >= extent[i].e_len)
+        return 0;
+
+    if (*count >= max_count)
+        return -ENOSPC;
+
+    uint32_t head_len = file_block - extent[i].e_block;
+
+    memmove(&extent[i + 2], &extent[i + 1], (*count - i - 1) * sizeof(struct hodo_extent));
+    extent[i + 1].e_block = file_block;
+    extent[i + 1].e_len = extent[i].e_len - head_len;
+    extent[i + 1].e_start = extent[i].e_start + head_len;
+    extent[i].e_len = head_len;
+    (*count)++;
+
+    return 0;
+}
+
+//e_block이 from 이상인 extent들을 delta만큼 옮긴다
+static void hodo_extent_array_shift(struct hodo_extent *extent, int count, uint32_t from, int64_t delta) {
+    for (int i = 0; i < count; i++) {
+        if (extent[i].e_block >= from)
+            extent[i].e_block += delta;
+    }
+}
+
+//hodo_inode 안의 extent들을 새 leaf block 하나로 옮기고, hodo_inode에는 그 leaf를 가리키는 index 하나만 남긴다
+static int hodo_extent_grow_depth(struct hodo_inode *file_inode) {
+    // ZONEFS_TRACE();
+
+    struct hodo_extent_leaf *leaf = hodo_alloc_block();
+    if (leaf == NULL)
+        return -ENOMEM;
+
+    memset(leaf, 0, HODO_DATABLOCK_SIZE);
+    leaf->magic[0] = 'E';
+    leaf->magic[1] = 'X';
+    leaf->magic[2] = 'T';
+    leaf->magic[3] = '0';
+    leaf->count = file_inode->i_extent_count;
+    memcpy(leaf->extent, file_inode->i_extent, file_inode->i_extent_count * sizeof(struct hodo_extent));
+
+    logical_block_number_t leaf_logical_number = NEW_DATABLOCK;
+    int ret = hodo_write_extent_leaf(leaf, &leaf_logical_number);
+    hodo_free_block(leaf);
+    if (ret < 0)
+        return ret;
+
+    //첫 index는 항상 파일 블록 0부터를 담당한다
+    memset(file_inode->i_extent, 0, sizeof(file_inode->i_extent));
+    file_inode->i_extent[0].e_block = 0;
+    file_inode->i_extent[0].e_start = leaf_logical_number;
+    file_inode->i_extent_count = 1;
+    file_inode->i_extent_depth = 1;
+
+    return 0;
+}
+
+//index번째 leaf의 뒤쪽 절반을 새 leaf로 옮기고 그 index를 index+1번째에 끼워 넣는다. 나눈 두 leaf는 모두 장치에 쓴다.
+static int hodo_extent_split_leaf(struct hodo_inode *file_inode, int index, struct hodo_extent_leaf *leaf) {
+    // ZONEFS_TRACE();
+
+    if (file_inode->i_extent_count >= HODO_INODE_EXTENT_COUNT)
+        return -EFBIG;
+
+    struct hodo_extent_leaf *new_leaf = hodo_alloc_block();
+    if (new_leaf == NULL)
+        return -ENOMEM;
+
+    int keep_count = leaf->count / 2;
+
+    memset(new_leaf, 0, HODO_DATABLOCK_SIZE);
+    new_leaf->magic[0] = 'E';
+    new_leaf->magic[1] = 'X';
+    new_leaf->magic[2] = 'T';
+    new_leaf->magic[3] = '0';
+    new_leaf->count = leaf->count - keep_count;
+    memcpy(new_leaf->extent, &leaf->extent[keep_count], new_leaf->count * sizeof(struct hodo_extent));
+
+    //새 leaf를 먼저 쓴다. 논리 번호를 받지 못했다면 원래 leaf는 그대로 둔다.
+    logical_block_number_t new_leaf_logical_number = NEW_DATABLOCK;
+    int ret = hodo_write_extent_leaf(new_leaf, &new_leaf_logical_number);
+    if (ret < 0) {
+        hodo_free_block(new_leaf);
+        return ret;
+    }
+
+    leaf->count = keep_count;
+    memset(&leaf->extent[keep_count], 0, (HODO_LEAF_EXTENT_COUNT - keep_count) * sizeof(struct hodo_extent));
+    hodo_write_extent_leaf(leaf, &file_inode->i_extent[index].e_start);
+
+    memmove(&file_inode->i_extent[index + 2], &file_inode->i_extent[index + 1], (file_inode->i_extent_count - index - 1) * sizeof(struct hodo_extent));
+    file_inode->i_extent[index + 1].e_block = new_leaf->extent[0].e_block;
+    file_inode->i_extent[index + 1].e_len = 0;
+    file_inode->i_extent[index + 1].e_start = new_leaf_logical_number;
+    file_inode->i_extent_count++;
+
+    hodo_free_block(new_leaf);
+    return 0;
+}
+
+//leaf_logical_number의 leaf가 든 cache slot. cache에 없으면 장치에서 읽어 채우고, 읽지 못하면 NULL이다. hodo_leaf_cache_lock을 잡고 부른다.
+static struct hodo_extent_leaf *hodo_leaf_cache_get(logical_block_number_t leaf_logical_number) {
+    int slot = leaf_logical_number % HODO_LEAF_CACHE_SIZE;
+
+    if (hodo_leaf_cache_tag[slot] == leaf_logical_number) {
+        hodo_stat_inc(HODO_STAT_LEAF_CACHE_HIT);
+        return &hodo_leaf_cache[slot];
+    }
+
+    hodo_stat_inc(HODO_STAT_LEAF_CACHE_MISS);
+    hodo_leaf_cache_tag[slot] = 0;
+
+    if (hodo_read_struct(leaf_logical_number, &hodo_leaf_cache[slot], HODO_DATABLOCK_SIZE) != HODO_DATABLOCK_SIZE)
+        return NULL;
+
+    hodo_leaf_cache_tag[slot] = leaf_logical_number;
+    return &hodo_leaf_cache[slot];
+}
+
+//leaf를 고쳐 쓰려는 쪽이 쓰는 복사본을 만든다
+static int hodo_read_extent_leaf(logical_block_number_t leaf_logical_number, struct hodo_extent_leaf *leaf) {
+    struct hodo_extent_leaf *cached;
+
+    mutex_lock(&hodo_leaf_cache_lock);
+    cached = hodo_leaf_cache_get(leaf_logical_number);
+    if (cached)
+        memcpy(leaf, cached, HODO_DATABLOCK_SIZE);
+    mutex_unlock(&hodo_leaf_cache_lock);
+
+    return cached ? 0 : -EIO;
+}
+
+//leaf를 장치에 쓰고 cache의 slot도 새 내용으로 바꾼다
+static int hodo_write_extent_leaf(struct hodo_extent_leaf *leaf, logical_block_number_t *leaf_logical_number) {
+    ssize_t ret = hodo_write_struct(leaf, HODO_DATABLOCK_SIZE, leaf_logical_number);
+
+    //새 leaf에 줄 논리 번호가 없었다면 cache에도 올리지 않는다
+    if (ret < 0 && !is_block_logical_number_valid(*leaf_logical_number))
+        return ret;
+
+    int slot = *leaf_logical_number % HODO_LEAF_CACHE_SIZE;
+
+    mutex_lock(&hodo_leaf_cache_lock);
+    memcpy(&hodo_leaf_cache[slot], leaf, HODO_DATABLOCK_SIZE);
+    hodo_leaf_cache_tag[slot] = *leaf_logical_number;
+    mutex_unlock(&hodo_leaf_cache_lock);
+
+    return 0;
+}
+
+//논리 번호가 해제되면 그 번호의 leaf도 더 이상 없다
+void hodo_extent_cache_forget(logical_block_number_t leaf_logical_number) {
+    int slot = leaf_logical_number % HODO_LEAF_CACHE_SIZE;
+
+    mutex_lock(&hodo_leaf_cache_lock);
+    if (hodo_leaf_cache_tag[slot] == leaf_logical_number)
+        hodo_leaf_cache_tag[slot] = 0;
+    mutex_unlock(&hodo_leaf_cache_lock);
+}
+
+//마운트할 때 이전 마운트의 leaf들을 버린다
+void hodo_extent_cache_reset(void) {
+    mutex_lock(&hodo_leaf_cache_lock);
+    memset(hodo_leaf_cache_tag, 0, sizeof(hodo_leaf_cache_tag));
+    mutex_unlock(&hodo_leaf_cache_lock);
+}
+
+
+/*-------------------------------------------------------------lookup용 함수----------------------------------------------------------------------------------*/
+uint64_t find_inode_number(struct hodo_inode *dir_hodo_inode, const char *target_name) {
+    // ZONEFS_TRACE();
+
+    //작은 디렉토리는 dirent들을 hodo 아이노드 안에 가지고 있으므로, 데이터블록을 더 읽지 않고 찾는다
+    if (is_inline_dir(dir_hodo_inode))
+        return find_inode_number_from_inline_dirent(dir_hodo_inode, target_name);
+
+    uint64_t result;
+    struct hodo_datablock *buf_block = hodo_alloc_block();
+
+    if (buf_block == NULL) {
+        // pr_info("zonefs: (error in hodo_sub_lookup) cannot allocate 4KB heap space for datablock variable\n");
+        return NOTHING_FOUND;
+    }
+
+    //direct data block들에서 특정 이름의 hodo dentry를 찾아보기
+    logical_block_number_t direct_block_logical_number;
+
+    for (int i = 0; i < 10; i++) {
+        direct_block_logical_number = dir_hodo_inode->direct[i];
+        
+        if(is_block_logical_number_valid(direct_block_logical_number)) {
+            hodo_read_struct(direct_block_logical_number, buf_block, HODO_DATABLOCK_SIZE);
+
+            result = find_inode_number_from_direct_block(buf_block, target_name);
+
+            if (result != NOTHING_FOUND) {
+                hodo_free_block(buf_block);
+                return result;
+            }
+        }
+    }
+
+    //single, double, triple indirect data block에서 특정 이름의 hodo dentry를 찾아보기
+    logical_block_number_t indirect_block_logical_number[3] = {
+        dir_hodo_inode->single_indirect,
+        dir_hodo_inode->double_indirect,
+        dir_hodo_inode->triple_indirect
+    };
+
+    for(int i = 0; i < 3; i++){
+        if(is_block_logical_number_valid(indirect_block_logical_number[i])) {
+            hodo_read_struct(indirect_block_logical_number[i], buf_block, HODO_DATABLOCK_SIZE);
+
+            result = find_inode_number_from_indirect_block(buf_block, target_name);
+
+            if (result != NOTHING_FOUND) {
+                hodo_free_block(buf_block);
+                return result;
+            }
+        }
+    }
+
+    //모두 다 뒤져보았지만 찾는데 실패한 경우
+    hodo_free_block(buf_block);
+    return NOTHING_FOUND;
+}
+
+uint64_t find_inode_number_from_direct_block(
+    struct hodo_datablock* direct_block,
+    const char *target_name
+) {
+    // ZONEFS_TRACE();
+
+    for (int j = HODO_DATA_START; j < HODO_DATABLOCK_SIZE - sizeof(struct hodo_dirent); j += sizeof(struct hodo_dirent)) {
+        struct hodo_dirent temp_dirent;
+        memcpy(&temp_dirent, (void*)direct_block + j, sizeof(struct hodo_dirent));
+
+        if (is_dirent_name_equal(&temp_dirent, target_name))
+            return temp_dirent.i_ino;
+    }
+
+    return NOTHING_FOUND;
+}
+
+uint64_t find_inode_number_from_indirect_block(
+    struct hodo_datablock *indirect_block,
+    const char *target_name
+) {
+    // ZONEFS_TRACE();
+
+    logical_block_number_t temp_block_logical_number;
+    struct hodo_datablock *temp_block = hodo_alloc_block();
+
+    if (temp_block == NULL) {
+        // pr_info("zonefs: (error in hodo_sub_lookup) cannot allocate 4KB heap space for datablock variable\n");
+        return NOTHING_FOUND;
+    }
+
+    for (int j = HODO_DATA_START; j < HODO_DATABLOCK_SIZE - BLOCK_PTR_SZ; j += BLOCK_PTR_SZ) {
+        memcpy(&temp_block_logical_number, (void*)indirect_block + j, BLOCK_PTR_SZ);
+
+        if(!is_block_logical_number_valid(temp_block_logical_number))
+            continue;
+
+        hodo_read_struct(temp_block_logical_number, temp_block, HODO_DATABLOCK_SIZE);
+
+        uint64_t result;
+
+        if(is_directblock(temp_block))
+            result = find_inode_number_from_direct_block(temp_block, target_name);
+
+        else 
+            result = find_inode_number_from_indirect_block(temp_block, target_name);
+
+        if (result != NOTHING_FOUND){
+            hodo_free_block(temp_block);
+            return result;
+        }
+    }
+
+    hodo_free_block(temp_block);
+    return NOTHING_FOUND;
+}
+
+uint64_t find_inode_number_from_inline_dirent(
+    struct hodo_inode *dir_hodo_inode,
+    const char *target_name
+) {
+    // ZONEFS_TRACE();
+
+    for (int i = 0; i < HODO_INLINE_DIRENT_COUNT; i++) {
+        if (is_dirent_name_equal(&dir_hodo_inode->inline_dirent[i], target_name))
+            return dir_hodo_inode->inline_dirent[i].i_ino;
+    }
+
+    return NOTHING_FOUND;
+}
+
+/*-------------------------------------------------------------readdir용 함수-------------------------------------------------------------------------------*/
+int read_all_dirents(
+    struct hodo_inode *dir_hodo_inode, 
+    struct dir_context *ctx, 
+    uint64_t *dirent_count
+) {
+    // ZONEFS_TRACE();
+
+    //작은 디렉토리는 hodo 아이노드 안의 dirent들만 읽으면 된다
+    if (is_inline_dir(dir_hodo_inode))
+        return read_all_dirents_from_inline_dirent(dir_hodo_inode, ctx, dirent_count);
+
+    struct hodo_datablock *buf_block = hodo_alloc_block();
+
+    if (buf_block == NULL) {
+        // pr_info("zonefs: (error in hodo_sub_readdir) cannot allocate 4KB heap space for datablock variable\n");
+        return END_READ;
+    }
+
+    int result;
+
+    //direct data block들에서 hodo dirent들을 읽어내기
+    logical_block_number_t direct_block_logical_number;
+
+    for (int i = 0; i < 10; i++) {
+        direct_block_logical_number = dir_hodo_inode->direct[i];
+        
+        if(is_block_logical_number_valid(direct_block_logical_number)) {
+            hodo_read_struct(direct_block_logical_number, buf_block, HODO_DATABLOCK_SIZE);
+
+            result = read_all_dirents_from_direct_block(buf_block, ctx, dirent_count);
+            
+            if(result == END_READ) {
+                hodo_free_block(buf_block);
+                return result;
+            }
+        }
+    }
+
+    //single, double, triple indirect data block에서 hodo dirent들을 읽어내기
+    logical_block_number_t indirect_block_logical_number[3] = {
+        dir_hodo_inode->single_indirect,
+        dir_hodo_inode->double_indirect,
+        dir_hodo_inode->triple_indirect
+    };
+
+    for(int i = 0; i < 3; i++){
+        if(is_block_logical_number_valid(indirect_block_logical_number[i])) {
+            hodo_read_struct(indirect_block_logical_number[i], buf_block, HODO_DATABLOCK_SIZE);
+
+            result = read_all_dirents_from_indirect_block(buf_block, ctx, dirent_count);
+
+            if(result == END_READ) {
+                hodo_free_block(buf_block);
+                return result;
+            }
+        }
+    }
+
+    //모두 잘 다 뒤져보았으므로 더 읽을 필요가 없음을 알려주기 위해 END_READ를 반환하고 끝낸다
+    hodo_free_block(buf_block);
+    return END_READ;
+}
+
+int read_all_dirents_from_direct_block(
+    struct hodo_datablock* direct_block,
+    struct dir_context *ctx,
+    uint64_t *dirent_count
+) {
+    // ZONEFS_TRACE();
+
+    for (int j = HODO_DATA_START; j < HODO_DATABLOCK_SIZE - sizeof(struct hodo_dirent); j += sizeof(struct hodo_dirent)) {
+        struct hodo_dirent temp_dirent;
+        memcpy(&temp_dirent, (void*)direct_block + j, sizeof(struct hodo_dirent));
+        
+        if(is_dirent_valid(&temp_dirent)) {
+            if(*dirent_count == ctx->pos) {
+                hodo_dir_emit(ctx, &temp_dirent);
+                ctx->pos++;
+            }
+
+            (*dirent_count)++;
+        }
+    }
+
+    return !END_READ;
+}
+
+int read_all_dirents_from_indirect_block(
+    struct hodo_datablock* indirect_block,
+    struct dir_context *ctx,
+    uint64_t *dirent_count
+) {
+    // ZONEFS_TRACE();
+
+    logical_block_number_t temp_block_logical_number;
+    struct hodo_datablock *temp_block = hodo_alloc_block();
+
+     if (temp_block == NULL) {
+        // pr_info("zonefs: (error in hodo_sub_readdir) cannot allocate 4KB heap space for datablock variable\n");
+        return 0;
+    }
+
+    for (int j = HODO_DATA_START; j < HODO_DATABLOCK_SIZE - BLOCK_PTR_SZ; j += BLOCK_PTR_SZ) {
+        memcpy(&temp_block_logical_number, (void*)indirect_block + j, BLOCK_PTR_SZ);
+
+        if(!is_block_logical_number_valid(temp_block_logical_number))
+            continue;
+
+        hodo_read_struct(temp_block_logical_number, temp_block, HODO_DATABLOCK_SIZE);
+
+        uint64_t result;
+
+        if(is_directblock(temp_block))
+            result = read_all_dirents_from_direct_block(temp_block, ctx, dirent_count);
+
+        else 
+            result = read_all_dirents_from_indirect_block(temp_block, ctx, dirent_count);
+
+        if (result == END_READ){
+            hodo_free_block(temp_block);
+            return result;
+        }
+    }
+
+    hodo_free_block(temp_block);
+    return !END_READ;
+}
+
+int read_all_dirents_from_inline_dirent(
+    struct hodo_inode *dir_hodo_inode,
+    struct dir_context *ctx,
+    uint64_t *dirent_count
+) {
+    // ZONEFS_TRACE();
+
+    for (int i = 0; i < HODO_INLINE_DIRENT_COUNT; i++) {
+        struct hodo_dirent *temp_dirent = &dir_hodo_inode->inline_dirent[i];
+
+        if(is_dirent_valid(temp_dirent)) {
+            if(*dirent_count == ctx->pos) {
+                //사용자 버퍼가 가득 찼다면 책갈피(ctx->pos)를 그대로 두고 멈춘다. 다음 호출이 여기서부터 이어서 읽는다.
+                if (!hodo_dir_emit(ctx, temp_dirent))
+                    return END_READ;
+                ctx->pos++;
+            }
+
+            (*dirent_count)++;
+        }
+    }
+
+    return END_READ;
+}
+
+static bool hodo_dir_emit(struct dir_context *ctx, struct hodo_dirent *temp_dirent){
+    return dir_emit(
+                    ctx,
+                    temp_dirent->name,
+                    temp_dirent->name_len,
+                    temp_dirent->i_ino,
+                    ((temp_dirent->file_type == HODO_TYPE_DIR) ? DT_DIR :
+                     (temp_dirent->file_type == HODO_TYPE_LNK) ? DT_LNK : DT_REG)
+    );
+}
+
+/*-------------------------------------------------------------create용 함수-------------------------------------------------------------------------------*/
+int add_dirent(struct inode* dir, struct hodo_inode* sub_inode) {
+    // ZONEFS_TRACE();
+
+    // read directory inode
+    logical_block_number_t dir_block_logical_number = dir->i_ino;
+    struct hodo_inode *dir_inode = hodo_alloc_block();
+    memset(dir_inode, 0, sizeof(struct hodo_inode));
+
+    hodo_lock_inode(dir);
+    hodo_read_inode(dir_block_logical_number, dir_inode);
+
+    //작은 디렉토리라면 hodo 아이노드 안의 빈 자리에 dirent를 넣고, 아이노드 블록 하나만 새로 쓴다
+    if (is_inline_dir(dir_inode)) {
+        struct hodo_dirent new_dirent = {0,};
+        memcpy(new_dirent.name, sub_inode->name, sub_inode->name_len);
+        new_dirent.name_len = sub_inode->name_len;
+        new_dirent.i_ino = sub_inode->i_ino;
+        new_dirent.file_type = sub_inode->type;
+
+        int ret = add_dirent_to_inline_dirent(dir_inode, &new_dirent);
+
+        hodo_unlock_inode(dir);
+        hodo_free_block(dir_inode);
+        return ret;
+    }
+
+    struct hodo_datablock* temp_datablock = hodo_alloc_block();
+
+    for (int i = 0; i < 10; ++i) {
+        // pr_info("%dth data block\n", i);
+        if (dir_inode->direct[i] != 0) {
+            logical_block_number_t temp_logical_number = dir_inode->direct[i];
+            hodo_read_struct(temp_logical_number, temp_datablock, sizeof(struct hodo_datablock));
+
+            for (int j = HODO_DATA_START; j < HODO_DATABLOCK_SIZE - sizeof(struct hodo_dirent); j += sizeof(struct hodo_dirent)) {
+                struct hodo_dirent temp_dirent;
+                memcpy(&temp_dirent, (void*)temp_datablock + j, sizeof(struct hodo_dirent));
+                
+                if(is_dirent_valid(&temp_dirent)) {
+                    continue; 
+                }
+                else {
+                    memset(&temp_dirent, 0, sizeof(struct hodo_dirent));
+                    memcpy(temp_dirent.name, sub_inode->name, sub_inode->name_len);
+                    temp_dirent.name_len = sub_inode->name_len;
+                    temp_dirent.i_ino = sub_inode->i_ino;
+                    temp_dirent.file_type = sub_inode->type;
+
+                    memcpy((void*)temp_datablock + j, &temp_dirent, sizeof(struct hodo_dirent));
+
+                    dir_inode->file_len++;
+                    hodo_write_struct(temp_datablock, sizeof(struct hodo_datablock), &temp_logical_number);
+
+                    hodo_write_inode(dir_inode);
+                    hodo_unlock_inode(dir);
+
+                    hodo_free_block(temp_datablock);
+                    hodo_free_block(dir_inode);
+                    return 0;
+                }
+            }
+        }
+        else {
+            struct hodo_dirent temp_dirent = {0,};
+            memcpy(temp_dirent.name, sub_inode->name, sub_inode->name_len);
+            temp_dirent.name_len = sub_inode->name_len;
+            temp_dirent.i_ino = sub_inode->i_ino;
+            temp_dirent.file_type = sub_inode->type;
+
+            memset(temp_datablock, 0, HODO_DATABLOCK_SIZE);
+            temp_datablock->magic[0] = 'D';
+            temp_datablock->magic[1] = 'A';
+            temp_datablock->magic[2] = 'T';
+            temp_datablock->magic[3] = '0';
+
+            memcpy((void*)temp_datablock + HODO_DATA_START, &temp_dirent, sizeof(struct hodo_dirent));
+
+            logical_block_number_t temp_logical_number = 0;
+            ssize_t ret = hodo_write_struct(temp_datablock, sizeof(struct hodo_datablock), &temp_logical_number);
+            if (ret < 0) {
+                hodo_unlock_inode(dir);
+                hodo_free_block(temp_datablock);
+                hodo_free_block(dir_inode);
+                return ret;
+            }
+
+            dir_inode->file_len++;
+            dir_inode->direct[i] = temp_logical_number;
+            hodo_write_inode(dir_inode);
+            hodo_unlock_inode(dir);
+
+            hodo_free_block(temp_datablock);
+            hodo_free_block(dir_inode);
+            return 0;
+        }
+    }
+
+    hodo_unlock_inode(dir);
+    hodo_free_block(temp_datablock);
+    hodo_free_block(dir_inode);
+    return -1;
+}
+
+int add_dirent_to_inline_dirent(struct hodo_inode *dir_inode, struct hodo_dirent *new_dirent) {
+    // ZONEFS_TRACE();
+
+    for (int i = 0; i < HODO_INLINE_DIRENT_COUNT; i++) {
+        if (is_dirent_valid(&dir_inode->inline_dirent[i]))
+            continue;
+
+        memcpy(&dir_inode->inline_dirent[i], new_dirent, sizeof(struct hodo_dirent));
+
+        dir_inode->file_len++;
+        hodo_write_inode(dir_inode);
+        return 0;
+    }
+
+    //inline dirent 자리가 가득 찼다. 지금까지의 dirent들과 새 dirent를 첫 번째 direct 데이터블록으로 옮기고,
+    //이후로는 블록 기반 디렉토리로 동작하도록 전환한다.
+    BUILD_BUG_ON(sizeof(dir_inode->inline_dirent) + sizeof(struct hodo_dirent) > HODO_DATA_SIZE);
+
+    struct hodo_datablock *temp_datablock = hodo_alloc_block();
+    if (temp_datablock == NULL)
+        return -ENOMEM;
+
+    memset(temp_datablock, 0, HODO_DATABLOCK_SIZE);
+    temp_datablock->magic[0] = 'D';
+    temp_datablock->magic[1] = 'A';
+    temp_datablock->magic[2] = 'T';
+    temp_datablock->magic[3] = '0';
+
+    memcpy(temp_datablock->data, dir_inode->inline_dirent, sizeof(dir_inode->inline_dirent));
+    memcpy(temp_datablock->data + sizeof(dir_inode->inline_dirent), new_dirent, sizeof(struct hodo_dirent));
+
+    logical_block_number_t temp_logical_number = 0;
+    ssize_t ret = hodo_write_struct(temp_datablock, sizeof(struct hodo_datablock), &temp_logical_number);
+    if (ret < 0) {
+        hodo_free_block(temp_datablock);
+        return ret;
+    }
+
+    dir_inode->direct[0] = temp_logical_number;
+    dir_inode->i_flags &= ~HODO_INODE_INLINE_DIRENT;
+    memset(dir_inode->inline_dirent, 0, sizeof(dir_inode->inline_dirent));
+
+    dir_inode->file_len++;
+    hodo_write_inode(dir_inode);
+
+    hodo_free_block(temp_datablock);
+    return 0;
+}
+
+/*-------------------------------------------------------------unlink용 함수-------------------------------------------------------------------------------*/
+int remove_dirent(struct hodo_inode *dir_hodo_inode, struct inode *dir, const char *target_name){
+    // ZONEFS_TRACE();
+
+    //작은 디렉토리는 hodo 아이노드 안에서 dirent를 지우고, 아이노드 블록 하나만 새로 쓴다
+    struct timespec64 now = current_time(dir);
+
+    if (is_inline_dir(dir_hodo_inode)) {
+        if (remove_dirent_from_inline_dirent(dir_hodo_inode, target_name) == NOTHING_FOUND)
+            return NOTHING_FOUND;
+
+        hodo_touch_dir_inode(dir_hodo_inode, dir, now);
+
+        dir_hodo_inode->file_len--;
+
+        hodo_write_inode(dir_hodo_inode);
+        return !NOTHING_FOUND;
+    }
+
+    struct hodo_datablock *buf_block = hodo_alloc_block();
+
+    if (buf_block == NULL) {
+        // pr_info("zonefs: (error in hodo_unlink) cannot allocate 4KB heap space for datablock variable\n");
+        return NOTHING_FOUND;
+    }
+
+    int result;
+    logical_block_number_t written_logical_number;
+
+    //direct data block에서 target_mapping_index를 가진 dirent를 찾아 지우기
+    logical_block_number_t direct_block_logical_number;
+
+    for (int i = 0; i < 10; i++) {
+        direct_block_logical_number = dir_hodo_inode->direct[i];
+        
+        if(is_block_logical_number_valid(direct_block_logical_number)) {
+            hodo_read_struct(direct_block_logical_number, buf_block, HODO_DATABLOCK_SIZE);
+
+            written_logical_number = direct_block_logical_number;
+            result = remove_dirent_from_direct_block(buf_block, target_name, &written_logical_number);
+            
+            if(result != NOTHING_FOUND) {
+                //dirent를 삭제하면서 direct_datablock가 새로 써지므로, 이를 가리키는 hodo_inode는 새로 써져야 한다.
+                dir_hodo_inode->direct[i] = written_logical_number;
+                hodo_touch_dir_inode(dir_hodo_inode, dir, now);
+                
+                //dirent가 삭제되면서 예하 파일 수가 줄어들었으므로, 이를 반영한다
+                dir_hodo_inode->file_len--;
+
+                hodo_write_inode(dir_hodo_inode);
+
+                hodo_free_block(buf_block);
+                return result;
+            }
+        }
+    }
+
+    //single, double, triple indirect data block들이 가리키는 direct_data_block에서 target_mapping_index를 가진 dirent를 찾아 지우기
+    logical_block_number_t indirect_block_logical_number[3] = {
+        dir_hodo_inode->single_indirect,
+        dir_hodo_inode->double_indirect,
+        dir_hodo_inode->triple_indirect
+    };
+
+    for(int i = 0; i < 3; i++){
+        if(is_block_logical_number_valid(indirect_block_logical_number[i])) {
+            hodo_read_struct(indirect_block_logical_number[i], buf_block, HODO_DATABLOCK_SIZE);
+
+            written_logical_number = indirect_block_logical_number[i];
+            result = remove_dirent_from_indirect_block(buf_block, target_name, &written_logical_number);
+
+            if(result != NOTHING_FOUND) {
+                //dirent를 삭제하면서 direct_datablock가 새로 써지고, 이를 가리키는 indirect_datablock도 새로 써지므로, 이를 가리키는 hodo_inode 또한 새로 써져야 한다.
+                indirect_block_logical_number[i] = written_logical_number;
+                hodo_touch_dir_inode(dir_hodo_inode, dir, now);
+
+                //dirent가 삭제되면서 예하 파일 수가 줄어들었으므로, 이를 반영한다
+                dir_hodo_inode->file_len--;
+
+                hodo_write_inode(dir_hodo_inode);
+                hodo_free_block(buf_block);
+                return result;
+            }
+        }
+    }
+
+    //해당 이름의 dirent를 찾아서 삭제하지 못하였으므로
+    hodo_free_block(buf_block);
+    return NOTHING_FOUND;
+}
+
+int remove_dirent_from_direct_block(
+    struct hodo_datablock *direct_block,
+    const char *target_name,
+    logical_block_number_t *out_logical_number
+) {
+    // ZONEFS_TRACE();
+
+    for (int j = HODO_DATA_START; j < HODO_DATABLOCK_SIZE - sizeof(struct hodo_dirent); j += sizeof(struct hodo_dirent)) {
+        struct hodo_dirent temp_dirent;
+        memcpy(&temp_dirent, (void*)direct_block + j, sizeof(struct hodo_dirent));
+
+        if (is_dirent_name_equal(&temp_dirent, target_name)){
+            compact_datablock(direct_block, j, sizeof(struct hodo_dirent), out_logical_number);
+
+            return !NOTHING_FOUND;
+        }
+    }
+
+    return NOTHING_FOUND;
+}
+
+int remove_dirent_from_indirect_block(
+    struct hodo_datablock *indirect_block,
+    const char *target_name,
+    logical_block_number_t *out_logical_number
+) {
+    // ZONEFS_TRACE();
+
+    logical_block_number_t temp_block_logical_number;
+    struct hodo_datablock *temp_block = hodo_alloc_block();
+
+    if (temp_block == NULL) {
+        // pr_info("zonefs: (error in hodo_unlink) cannot allocate 4KB heap space for datablock variable\n");
+        return NOTHING_FOUND;
+    }
+
+    for (int j = HODO_DATA_START; j < HODO_DATABLOCK_SIZE - BLOCK_PTR_SZ; j += BLOCK_PTR_SZ) {
+        memcpy(&temp_block_logical_number, (void*)indirect_block + j, BLOCK_PTR_SZ);
+
+        if(!is_block_logical_number_valid(temp_block_logical_number))  
+            continue;
+
+        hodo_read_struct(temp_block_logical_number, temp_block, HODO_DATABLOCK_SIZE);
+
+        int result;
+        logical_block_number_t written_logical_number = temp_block_logical_number;
+
+        if(is_directblock(temp_block))
+            result = remove_dirent_from_direct_block(temp_block, target_name, &written_logical_number);
+
+        else 
+            result = remove_dirent_from_indirect_block(temp_block, target_name, &written_logical_number);
+
+        if (result != NOTHING_FOUND && is_block_logical_number_valid(written_logical_number)){
+            //dirent를 삭제하면서 direct_datablock가 새로 써지므로, 이를 가리키는 indirect_datablock도 거슬러 올라가며 새로 써져야 한다.
+            memcpy((void*)indirect_block + j, &written_logical_number, BLOCK_PTR_SZ);
+            hodo_write_struct(indirect_block, sizeof(struct hodo_datablock), out_logical_number);
+
+            hodo_free_block(temp_block);
+            return result;
+        }
+    }
+
+    hodo_free_block(temp_block);
+    return NOTHING_FOUND;
+}
+
+int remove_dirent_from_inline_dirent(struct hodo_inode *dir_hodo_inode, const char *target_name) {
+    // ZONEFS_TRACE();
+
+    for (int i = 0; i < HODO_INLINE_DIRENT_COUNT; i++) {
+        if (!is_dirent_name_equal(&dir_hodo_inode->inline_dirent[i], target_name))
+            continue;
+
+        //compact_datablock과 마찬가지로, 뒤쪽 dirent들을 앞으로 당겨서 빈 자리가 생기지 않도록 한다
+        memmove(&dir_hodo_inode->inline_dirent[i], &dir_hodo_inode->inline_dirent[i + 1],
+                (HODO_INLINE_DIRENT_COUNT - i - 1) * sizeof(struct hodo_dirent));
+        memset(&dir_hodo_inode->inline_dirent[HODO_INLINE_DIRENT_COUNT - 1], 0, sizeof(struct hodo_dirent));
+
+        return !NOTHING_FOUND;
+    }
+
+    return NOTHING_FOUND;
+}
+
+//dirent가 바뀐 디렉토리 아이노드의 mtime, ctime을 now로 고친다. 어차피 아이노드를 새로 쓰므로 메모리에만 있던 atime도 함께 싣는다.
+static void hodo_touch_dir_inode(struct hodo_inode *dir_hodo_inode, struct inode *dir, struct timespec64 now) {
+    hodo_load_inode_times(dir_hodo_inode, dir);
+    dir_hodo_inode->i_mtime = now;
+    dir_hodo_inode->i_ctime = now;
+}
+
+/*-------------------------------------------------------------rename용 함수 선언-------------------------------------------------------------------------------*/
+//target_name이라는 dirent를 그 자리에서 sub_inode를 가리키는 dirent로 바꾼다. 블록은 같은 논리 번호에 다시 쓰이므로 블록을 가리키던 쪽은 고칠 필요가 없다.
+//dirent가 든 블록 하나(inline 디렉토리라면 디렉토리 아이노드 하나)만 새로 쓴다.
+int replace_dirent(struct hodo_inode *dir_hodo_inode, struct inode *dir, const char *target_name, struct hodo_inode *sub_inode) {
+    // ZONEFS_TRACE();
+
+    struct timespec64 now = current_time(dir);
+    int result = NOTHING_FOUND;
+
+    if (is_inline_dir(dir_hodo_inode)) {
+        result = replace_dirent_in_inline_dirent(dir_hodo_inode, target_name, sub_inode);
+    }
+    else {
+        struct hodo_datablock *buf_block = hodo_alloc_block();
+
+        for (int i = 0; i < 10 && result == NOTHING_FOUND; i++) {
+            if (is_block_logical_number_valid(dir_hodo_inode->direct[i]))
+                result = replace_dirent_in_block(dir_hodo_inode->direct[i], buf_block, target_name, sub_inode);
+        }
+
+        logical_block_number_t indirect_block_logical_number[3] = {
+            dir_hodo_inode->single_indirect,
+            dir_hodo_inode->double_indirect,
+            dir_hodo_inode->triple_indirect
+        };
+
+        for (int i = 0; i < 3 && result == NOTHING_FOUND; i++) {
+            if (is_block_logical_number_valid(indirect_block_logical_number[i]))
+                result = replace_dirent_in_block(indirect_block_logical_number[i], buf_block, target_name, sub_inode);
+        }
+
+        hodo_free_block(buf_block);
+    }
+
+    if (result == NOTHING_FOUND)
+        return NOTHING_FOUND;
+
+    hodo_touch_dir_inode(dir_hodo_inode, dir, now);
+    hodo_write_inode(dir_hodo_inode);
+
+    return !NOTHING_FOUND;
+}
+
+//logical_block_number의 dirent 블록(또는 indirect 블록이 가리키는 블록들)에서 target_name을 찾아 바꾼다. buf_block은 읽기에 쓰는 임시 블록이다.
+int replace_dirent_in_block(logical_block_number_t logical_block_number, struct hodo_datablock *buf_block, const char *target_name, struct hodo_inode *sub_inode) {
+    // ZONEFS_TRACE();
+
+    hodo_read_struct(logical_block_number, buf_block, HODO_DATABLOCK_SIZE);
+
+    if (is_directblock(buf_block)) {
+        for (int j = HODO_DATA_START; j < HODO_DATABLOCK_SIZE - sizeof(struct hodo_dirent); j += sizeof(struct hodo_dirent)) {
+            struct hodo_dirent temp_dirent;
+            memcpy(&temp_dirent, (void*)buf_block + j, sizeof(struct hodo_dirent));
+
+            if (!is_dirent_name_equal(&temp_dirent, target_name))
+                continue;
+
+            fill_dirent(&temp_dirent, sub_inode);
+            memcpy((void*)buf_block + j, &temp_dirent, sizeof(struct hodo_dirent));
+            hodo_write_struct(buf_block, sizeof(struct hodo_datablock), &logical_block_number);
+
+            return !NOTHING_FOUND;
+        }
+
+        return NOTHING_FOUND;
+    }
+
+    //indirect 블록이라면 가리키는 블록들을 차례로 본다. 읽은 indirect 블록은 재귀 호출이 buf_block을 덮어쓰므로 따로 둔다.
+    struct hodo_datablock *indirect_block = hodo_alloc_block();
+    logical_block_number_t temp_block_logical_number;
+    int result = NOTHING_FOUND;
+
+    memcpy(indirect_block, buf_block, HODO_DATABLOCK_SIZE);
+
+    for (int j = HODO_DATA_START; j < HODO_DATABLOCK_SIZE - BLOCK_PTR_SZ && result == NOTHING_FOUND; j += BLOCK_PTR_SZ) {
+        memcpy(&temp_block_logical_number, (void*)indirect_block + j, BLOCK_PTR_SZ);
+
+        if (is_block_logical_number_valid(temp_block_logical_number))
+            result = replace_dirent_in_block(temp_block_logical_number, buf_block, target_name, sub_inode);
+    }
+
+    hodo_free_block(indirect_block);
+    return result;
+}
+
+int replace_dirent_in_inline_dirent(struct hodo_inode *dir_hodo_inode, const char *target_name, struct hodo_inode *sub_inode) {
+    // ZONEFS_TRACE();
+
+    for (int i = 0; i < HODO_INLINE_DIRENT_COUNT; i++) {
+        if (!is_dirent_name_equal(&dir_hodo_inode->inline_dirent[i], target_name))
+            continue;
+
+        fill_dirent(&dir_hodo_inode->inline_dirent[i], sub_inode);
+        return !NOTHING_FOUND;
+    }
+
+    return NOTHING_FOUND;
+}
+
+//sub_inode의 이름, 아이노드 번호, 종류로 dirent를 채운다
+void fill_dirent(struct hodo_dirent *dirent, struct hodo_inode *sub_inode) {
+    memset(dirent, 0, sizeof(struct hodo_dirent));
+    memcpy(dirent->name, sub_inode->name, sub_inode->name_len);
+    dirent->name_len = sub_inode->name_len;
+    dirent->i_ino = sub_inode->i_ino;
+    dirent->file_type = sub_inode->type;
+}
+
+/*-------------------------------------------------------------rmdir용 함수 선언--------------------------------------------------------------------------------*/
+bool check_directory_empty(struct dentry *dentry){
+    // ZONEFS_TRACE();
+    
+    //디렉토리가 루트 디록테리면 매핑 테이블에서 인덱스를 아이노드 번호가 아니라, 0번을 이용해야 하므로 루트 디렉토리인지를 확인한다.
+    uint64_t dir_mapping_index;
+
+    if(dentry->d_inode == dentry->d_sb->s_root->d_inode) {
+        dir_mapping_index = mapping_info.starting_logical_number;
+    }
+    else {
+        dir_mapping_index = dentry->d_inode->i_ino;
+    }
+
+    //디렉토리의 hodo 아이노드를 저장장치로부터 읽어온다
+    logical_block_number_t dir_hodo_logical_number= dir_mapping_index;
+    struct hodo_inode *dir_hodo_inode = hodo_alloc_block();
+    hodo_read_inode(dir_hodo_logical_number, dir_hodo_inode);
+
+    //작은 디렉토리는 hodo 아이노드 안의 dirent들만 확인하면 된다
+    if (is_inline_dir(dir_hodo_inode)) {
+        bool empty = check_directory_empty_from_inline_dirent(dir_hodo_inode);
+
+        hodo_free_block(dir_hodo_inode);
+        return empty;
+    }
+
+    //디렉토리 hodo 아이노드가 가리키는 데이터블록들을 순회할 준비를 한다
+    struct hodo_datablock *buf_block = hodo_alloc_block();
+
+    if (buf_block == NULL) {
+        // pr_info("zonefs: (error in hodo_sub_readdir) cannot allocate 4KB heap space for datablock variable\n");
+        hodo_free_block(dir_hodo_inode);
+        return EMPTY_CHECKED;
+    }
+
+    int result;
+
+    //direct data block들이 비워져있는지 확인하기
+    logical_block_number_t direct_block_logical_number;
+
+    for (int i = 0; i < 10; i++) {
+        direct_block_logical_number = dir_hodo_inode->direct[i];
+        
+        if(is_block_logical_number_valid(direct_block_logical_number)) {
+
+            hodo_read_struct(direct_block_logical_number, buf_block, HODO_DATABLOCK_SIZE);
+
+            result = check_directory_empty_from_direct_block(buf_block);
+            
+            if(result != EMPTY_CHECKED) {
+                hodo_free_block(buf_block);
+                hodo_free_block(dir_hodo_inode);
+                return result;
+            }
+        }
+    }
+
+    //single, double, triple indirect data block를 통해 간접적으로 가리키는 direct_data_block들이 비워져있는지 확인하기
+    logical_block_number_t indirect_block_logical_number[3] = {
+        dir_hodo_inode->single_indirect,
+        dir_hodo_inode->double_indirect,
+        dir_hodo_inode->triple_indirect
+    };
+
+    for(int i = 0; i < 3; i++){
+        if(is_block_logical_number_valid(indirect_block_logical_number[i])) {
+            hodo_read_struct(indirect_block_logical_number[i], buf_block, HODO_DATABLOCK_SIZE);
+
+            result = check_directory_empty_from_indirect_block(buf_block);
+
+            if(result != EMPTY_CHECKED) {
+                hodo_free_block(buf_block);
+                hodo_free_block(dir_hodo_inode);
+                return result;
+            }
+        }
+    }
+
+    //모두 잘 다 뒤져보았으므로 더 읽을 필요가 없음을 알려주기 위해 EMPTY_CHECKED를 반환하고 끝낸다
+    hodo_free_block(buf_block);
+    hodo_free_block(dir_hodo_inode);
+    return EMPTY_CHECKED;
+}
+
+bool check_directory_empty_from_direct_block(struct hodo_datablock *direct_block){
+    // ZONEFS_TRACE();
+
+    const char zero[HODO_DATABLOCK_SIZE - HODO_DATA_START] = {0};
+
+    if(memcmp(direct_block->data, zero, HODO_DATABLOCK_SIZE - HODO_DATA_START) == 0)
+        return EMPTY_CHECKED;
+    else
+        return !EMPTY_CHECKED;
+}
+
+bool check_directory_empty_from_indirect_block(struct hodo_datablock *indirect_block){
+    // ZONEFS_TRACE();
+
+    logical_block_number_t temp_block_logical_number;
+    struct hodo_datablock *temp_block = hodo_alloc_block();
+
+    if (temp_block == NULL) {
+        // pr_info("zonefs: (error in hodo_sub_lookup) cannot allocate 4KB heap space for datablock variable\n");
+        return EMPTY_CHECKED;
+    }
+
+    for (int j = HODO_DATA_START; j < HODO_DATABLOCK_SIZE - BLOCK_PTR_SZ; j += BLOCK_PTR_SZ) {
+        memcpy(&temp_block_logical_number, (void*)indirect_block + j, BLOCK_PTR_SZ);
+
+        if(!is_block_logical_number_valid(temp_block_logical_number))
+            continue;
+
+        hodo_read_struct(temp_block_logical_number, temp_block, HODO_DATABLOCK_SIZE);
+
+        uint64_t result;
+
+        if(is_directblock(temp_block))
+            result = check_directory_empty_from_direct_block(temp_block);
+
+        else 
+            result = check_directory_empty_from_indirect_block(temp_block);
+
+        if (result != EMPTY_CHECKED){
+            hodo_free_block(temp_block);
+            return result;
+        }
+    }
+
+    hodo_free_block(temp_block);
+    return EMPTY_CHECKED;
+}
+
+bool check_directory_empty_from_inline_dirent(struct hodo_inode *dir_hodo_inode){
+    // ZONEFS_TRACE();
+
+    for (int i = 0; i < HODO_INLINE_DIRENT_COUNT; i++) {
+        if (is_dirent_valid(&dir_hodo_inode->inline_dirent[i]))
+            return !EMPTY_CHECKED;
+    }
+
+    return EMPTY_CHECKED;
+}
+
+/*-------------------------------------------------------------비트맵용 함수-------------------------------------------------------------------------------*/
+//논리 번호 할당기. logical_entry_bitmap의 bit 하나가 논리 번호 하나이며, 커널 bitop 순서(word 안에서 bit 0부터)를 따른다.
+//hodo_logical_full_words는 bitmap의 word마다 bit 하나로 그 word가 가득 찼는지를 기록해서, 빈 번호가 있는 word를 바로 찾게 해준다.
+//각 CPU는 번호 몇 개를 미리 떼어 두고 잠금 없이 꺼내 쓴다.
+#define HODO_LOGICAL_WORDS              (NUMBER_MAPPING_TABLE_ENTRY / BITS_PER_LONG)
+#define HODO_LOGICAL_BATCH              16
+
+struct hodo_logical_batch {
+    unsigned int count;
+    logical_block_number_t numbers[HODO_LOGICAL_BATCH];    // 뒤에서부터 꺼내므로 큰 번호부터 담는다
+};
+
+static DEFINE_SPINLOCK(hodo_logical_lock);
+static unsigned long hodo_logical_full_words[BITS_TO_LONGS(HODO_LOGICAL_WORDS)];
+static unsigned long hodo_logical_hint;                    // 다음 검색을 시작할 word
+static uint32_t hodo_free_logical_count;
+static DEFINE_PER_CPU(struct hodo_logical_batch, hodo_logical_batch);
+
+//hodo_logical_lock을 잡고 호출한다
+static void hodo_set_logical_bitmap(unsigned long index) {
+    unsigned long word = index / BITS_PER_LONG;
+
+    __set_bit(index, mapping_info.logical_entry_bitmap);
+    hodo_free_logical_count--;
+
+    if (mapping_info.logical_entry_bitmap[word] == ~0UL)
+        __set_bit(word, hodo_logical_full_words);
+}
+
+//hodo_logical_lock을 잡고 호출한다
+static void hodo_unset_logical_bitmap(unsigned long index) {
+    __clear_bit(index, mapping_info.logical_entry_bitmap);
+    __clear_bit(index / BITS_PER_LONG, hodo_logical_full_words);
+    hodo_free_logical_count++;
+}
+
+//hodo_logical_lock을 잡고 호출한다. hint word부터 빈 번호가 있는 word를 찾고, 끝까지 없으면 처음부터 다시 찾는다.
+static long hodo_find_free_logical_index(void) {
+    unsigned long word = find_next_zero_bit(hodo_logical_full_words, HODO_LOGICAL_WORDS, hodo_logical_hint);
+
+    if (word >= HODO_LOGICAL_WORDS)
+        word = find_first_zero_bit(hodo_logical_full_words, HODO_LOGICAL_WORDS);
+    if (word >= HODO_LOGICAL_WORDS)
+        return -1;
+
+    hodo_logical_hint = word;
+    return word * BITS_PER_LONG + ffz(mapping_info.logical_entry_bitmap[word]);
+}
+
+//이 CPU의 batch를 빈 논리 번호들로 다시 채운다
+static void hodo_refill_logical_batch(struct hodo_logical_batch *batch) {
+    logical_block_number_t numbers[HODO_LOGICAL_BATCH];
+    unsigned int count = 0;
+
+    spin_lock(&hodo_logical_lock);
+    while (count < HODO_LOGICAL_BATCH) {
+        long index = hodo_find_free_logical_index();
+        if (index < 0)
+            break;
+
+        hodo_set_logical_bitmap(index);
+        numbers[count++] = mapping_info.starting_logical_number + index;
+    }
+    spin_unlock(&hodo_logical_lock);
+
+    for (unsigned int i = 0; i < count; i++)
+        batch->numbers[i] = numbers[count - 1 - i];
+    batch->count = count;
+}
+
+//마운트할 때 장치에서 읽은 bitmap으로 요약 bitmap과 빈 번호 개수를 다시 만든다
+void hodo_init_logical_allocator(void) {
+    int cpu;
+
+    spin_lock(&hodo_logical_lock);
+
+    //seq, cnv 디렉토리의 VFS 아이노드 번호(zone 수 + 1, + 2)는 hodo 논리 번호와 겹친다.
+    //그 번호를 받은 hodo 아이노드는 icache에서 zone 그룹 디렉토리와 섞이므로, 두 번호는 쓰는 것으로 표시해 아무에게도 주지 않는다.
+    for (unsigned long index = 1; index <= ZONEFS_ZTYPE_MAX; index++)
+        __set_bit(index, mapping_info.logical_entry_bitmap);
+
+    bitmap_zero(hodo_logical_full_words, HODO_LOGICAL_WORDS);
+    for (unsigned long word = 0; word < HODO_LOGICAL_WORDS; word++) {
+        if (mapping_info.logical_entry_bitmap[word] == ~0UL)
+            __set_bit(word, hodo_logical_full_words);
+    }
+
+    hodo_free_logical_count = NUMBER_MAPPING_TABLE_ENTRY - bitmap_weight(mapping_info.logical_entry_bitmap, NUMBER_MAPPING_TABLE_ENTRY);
+    hodo_logical_hint = 0;
+    spin_unlock(&hodo_logical_lock);
+
+    for_each_possible_cpu(cpu)
+        per_cpu_ptr(&hodo_logical_batch, cpu)->count = 0;
+}
+
+//CPU들이 떼어 두고 쓰지 않은 번호들을 bitmap에 돌려준다
+void hodo_drain_logical_batches(void) {
+    int cpu;
+
+    spin_lock(&hodo_logical_lock);
+    for_each_possible_cpu(cpu) {
+        struct hodo_logical_batch *batch = per_cpu_ptr(&hodo_logical_batch, cpu);
+
+        while (batch->count > 0)
+            hodo_unset_logical_bitmap(batch->numbers[--batch->count] - mapping_info.starting_logical_number);
+    }
+    spin_unlock(&hodo_logical_lock);
+}
+
+//빈 논리 번호 개수. CPU들이 떼어 둔 번호도 아직 쓰이지 않았으므로 빈 번호로 센다.
+uint32_t hodo_get_free_logical_count(void) {
+    uint32_t count = READ_ONCE(hodo_free_logical_count);
+    int cpu;
+
+    for_each_possible_cpu(cpu)
+        count += READ_ONCE(per_cpu_ptr(&hodo_logical_batch, cpu)->count);
+
+    return count;
+}
+
+//논리 번호가 모두 쓰였다면 -ENOSPC를 반환한다. 받은 번호를 쓰기 전에 호출한 쪽이 확인한다.
+int hodo_get_next_logical_number(void) {
+    struct hodo_logical_batch *batch = get_cpu_ptr(&hodo_logical_batch);
+    int ret = -ENOSPC;
+
+    if (batch->count == 0)
+        hodo_refill_logical_batch(batch);
+
+    if (batch->count > 0)
+        ret = batch->numbers[--batch->count];
+
+    put_cpu_ptr(&hodo_logical_batch);
+    // pr_info("return logical number : %d\n", ret);
+    return ret;
+}
+
+//hint 논리 번호가 비어 있으면 그것을, 아니면 아무 빈 논리 번호를 할당한다
+int hodo_get_logical_number_near(logical_block_number_t hint) {
+    unsigned long bitmap_index = hint - mapping_info.starting_logical_number;
+
+    if (hint >= mapping_info.starting_logical_number && bitmap_index < NUMBER_MAPPING_TABLE_ENTRY) {
+        spin_lock(&hodo_logical_lock);
+        if (!test_bit(bitmap_index, mapping_info.logical_entry_bitmap)) {
+            hodo_set_logical_bitmap(bitmap_index);
+            spin_unlock(&hodo_logical_lock);
+            return hint;
+        }
+        spin_unlock(&hodo_logical_lock);
+    }
+
+    return hodo_get_next_logical_number();
+}
+
+static void hodo_set_GC_bitmap(struct hodo_block_pos physical_address) {
+    int zone_id = physical_address.zone_id;
+    int block_index = physical_address.block_index;
+    uint32_t mask = 1 << (31 - (block_index % 32));
+
+    spin_lock(&hodo_zone_stats_lock);
+    if (!(mapping_info.GC_bitmap[zone_id][block_index / 32] & mask)) {
+        mapping_info.GC_bitmap[zone_id][block_index / 32] |= mask;
+
+        hodo_zone_valid_count[zone_id]++;
+        mapping_info.valid_count++;
+        hodo_victim_heap_fix(zone_id);
+    }
+    spin_unlock(&hodo_zone_stats_lock);
+}
+
+static void hodo_unset_GC_bitmap(struct hodo_block_pos physical_address) {
+    int zone_id = physical_address.zone_id;
+    int block_index = physical_address.block_index;
+    uint32_t mask = 1 << (31 - (block_index % 32));
+
+    spin_lock(&hodo_zone_stats_lock);
+    if (mapping_info.GC_bitmap[zone_id][block_index / 32] & mask) {
+        mapping_info.GC_bitmap[zone_id][block_index / 32] &= ~mask;
+
+        hodo_zone_valid_count[zone_id]--;
+        mapping_info.valid_count--;
+        mapping_info.invalid_count++;
+        hodo_victim_heap_fix(zone_id);
+    }
+    spin_unlock(&hodo_zone_stats_lock);
+}
+
+static struct hodo_block_pos hodo_get_next_GC_valid(void) {
+    struct hodo_block_pos start_pos = mapping_info.wp;
+    struct hodo_block_pos ret = {0,0}; 
+
+    spin_lock(&hodo_zone_stats_lock);
+    for (int i = start_pos.zone_id; i < NUMBER_ZONES - 2; ++i) {
+        for (int j = 0; j < (BLOCKS_PER_ZONE / 32); ++j) {
+            if (mapping_info.GC_bitmap[i][j] != 0x00000000) {
+                for (int k = 0; k < 32; ++k) {
+                    if ((mapping_info.GC_bitmap[i][j] & (1 << (31 - k))) != 0) {
+                        ret.zone_id = i;
+                        ret.block_index = (j * 32) + k;
+                        // pr_info("GC bitmap return value: (%d,%d)\n", ret.zone_id, ret.block_index);
+                        spin_unlock(&hodo_zone_stats_lock);
+                        return ret;
+                    }
+                }
+            }
+        }
+    }
+    spin_unlock(&hodo_zone_stats_lock);
+
+    return ret;
+}
+
+int hodo_erase_table_entry(int table_entry_index) {
+    int bitmap_index = table_entry_index - mapping_info.starting_logical_number;
+
+    mapping_info.mapping_table[bitmap_index].zone_id = 0;  // check invalid
+    hodo_extent_cache_forget(table_entry_index);
+
+    spin_lock(&hodo_logical_lock);
+    hodo_unset_logical_bitmap(bitmap_index);
+    spin_unlock(&hodo_logical_lock);
+    return 0;
+}
+
+//파일 데이터블록처럼 논리 번호 start부터 len개가 이어져 있는 블록들을 한꺼번에 풀어준다.
+//물리 위치는 블록마다 무효로 표시하지만, 논리 번호는 잠금 한 번에 bitmap에서 범위째로 지운다.
+static void hodo_release_logical_range(logical_block_number_t start, uint32_t len) {
+    unsigned long bitmap_index = start - mapping_info.starting_logical_number;
+    unsigned long first_word = bitmap_index / BITS_PER_LONG;
+    unsigned long last_word;
+
+    if (len == 0)
+        return;
+
+    //다른 파일과 나눠 쓰는 블록이 섞여 있다면 하나씩 보면서, 나눠 쓰는 블록은 공유 수만 줄인다
+    if (hodo_is_range_shared(start, len)) {
+        for (uint32_t i = 0; i < len; i++) {
+            if (hodo_put_shared_block(start + i))
+                continue;
+
+            hodo_drop_physical_block(start + i);
+
+            spin_lock(&hodo_logical_lock);
+            hodo_unset_logical_bitmap(bitmap_index + i);
+            spin_unlock(&hodo_logical_lock);
+        }
+        return;
+    }
+
+    for (uint32_t i = 0; i < len; i++)
+        hodo_drop_physical_block(start + i);
+
+    last_word = (bitmap_index + len - 1) / BITS_PER_LONG;
+
+    spin_lock(&hodo_logical_lock);
+    bitmap_clear(mapping_info.logical_entry_bitmap, bitmap_index, len);
+    bitmap_clear(hodo_logical_full_words, first_word, last_word - first_word + 1);
+    hodo_free_logical_count += len;
+    spin_unlock(&hodo_logical_lock);
+}
+
+/*-------------------------------------------------------------공유 블록용 함수-------------------------------------------------------------------------------*/
+//reflink된 블록은 여러 파일의 extent가 같은 논리 번호를 가리킨다. share_count는 처음 파일을 뺀 나머지 파일의 수이며 hodo_logical_lock으로 지킨다.
+//파일이 블록을 놓을 때 share_count가 0이 아니라면 그 수만 줄이고, 0이라면 그 파일이 마지막이므로 블록을 풀어준다.
+bool hodo_is_block_shared(logical_block_number_t logical_block_number) {
+    return READ_ONCE(mapping_info.share_count[logical_block_number - mapping_info.starting_logical_number]) != 0;
+}
+
+static bool hodo_is_range_shared(logical_block_number_t start, uint32_t len) {
+    for (uint32_t i = 0; i < len; i++) {
+        if (hodo_is_block_shared(start + i))
+            return true;
+    }
+
+    return false;
+}
+
+//논리 번호 start부터 len개를 가리키는 파일이 하나 늘었다. 한 블록이라도 더 나눌 수 없다면 아무것도 바꾸지 않고 false를 반환한다.
+bool hodo_get_shared_range(logical_block_number_t start, uint32_t len) {
+    unsigned long bitmap_index = start - mapping_info.starting_logical_number;
+
+    spin_lock(&hodo_logical_lock);
+    for (uint32_t i = 0; i < len; i++) {
+        if (mapping_info.share_count[bitmap_index + i] == U16_MAX) {
+            spin_unlock(&hodo_logical_lock);
+            return false;
+        }
+    }
+
+    for (uint32_t i = 0; i < len; i++)
+        mapping_info.share_count[bitmap_index + i]++;
+    spin_unlock(&hodo_logical_lock);
+
+    return true;
+}
+
+//블록을 나눠 쓰고 있었다면 공유 수를 하나 줄이고 true를 반환한다. false라면 부른 쪽이 마지막 파일이므로 블록을 풀어줘야 한다.
+static bool hodo_put_shared_block(logical_block_number_t logical_block_number) {
+    unsigned long bitmap_index = logical_block_number - mapping_info.starting_logical_number;
+    bool shared = false;
+
+    spin_lock(&hodo_logical_lock);
+    if (mapping_info.share_count[bitmap_index] != 0) {
+        mapping_info.share_count[bitmap_index]--;
+        shared = true;
+    }
+    spin_unlock(&hodo_logical_lock);
+
+    return shared;
+}
+
+/*-------------------------------------------------------------zone 통계용 함수-------------------------------------------------------------------------------*/
+static uint32_t hodo_victim_key(int zone_id) {
+    if (zone_id >= mapping_info.wp.zone_id)
+        return U32_MAX;
+
+    return hodo_zone_valid_count[zone_id];
+}
+
+static void hodo_victim_heap_swap(int i, int j) {
+    int zone_i = hodo_victim_heap[i];
+    int zone_j = hodo_victim_heap[j];
+
+    hodo_victim_heap[i] = zone_j;
+    hodo_victim_heap[j] = zone_i;
+    hodo_victim_heap_index[zone_j] = i;
+    hodo_victim_heap_index[zone_i] = j;
+}
+
+//hodo_zone_stats_lock을 잡고 호출한다. zone_id의 key가 바뀌었으니 heap 안에서 제자리를 찾아 올리거나 내린다
+static void hodo_victim_heap_fix(int zone_id) {
+    int i = hodo_victim_heap_index[zone_id];
+
+    if (i < 0)
+        return;
+
+    while (i > 0 && hodo_victim_key(hodo_victim_heap[(i - 1) / 2]) > hodo_victim_key(hodo_victim_heap[i])) {
+        hodo_victim_heap_swap(i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+
+    while (1) {
+        int left = 2 * i + 1;
+        int right = left + 1;
+        int smallest = i;
+
+        if (left < hodo_victim_heap_size && hodo_victim_key(hodo_victim_heap[left]) < hodo_victim_key(hodo_victim_heap[smallest]))
+            smallest = left;
+        if (right < hodo_victim_heap_size && hodo_victim_key(hodo_victim_heap[right]) < hodo_victim_key(hodo_victim_heap[smallest]))
+            smallest = right;
+        if (smallest == i)
+            break;
+
+        hodo_victim_heap_swap(i, smallest);
+        i = smallest;
+    }
+}
+
+//GC_bitmap에서 zone별 살아있는 블록 수, 전체 유효/무효 블록 수, victim heap을 다시 만든다. 마운트할 때와 GC가 끝났을 때 부른다.
+void hodo_rebuild_zone_stats(void) {
+    int last_data_zone = min(hodo_nr_zones, NUMBER_ZONES) - 3;     // 끝의 두 zone은 swap zone과 예비 zone이다
+
+    spin_lock(&hodo_zone_stats_lock);
+    mapping_info.valid_count = 0;
+    mapping_info.invalid_count = 0;
+    hodo_victim_heap_size = 0;
+
+    for (int zone_id = 0; zone_id < NUMBER_ZONES; zone_id++) {
+        uint32_t valid = 0;
+
+        for (int j = 0; j < (BLOCKS_PER_ZONE / 32); ++j)
+            valid += hweight32(mapping_info.GC_bitmap[zone_id][j]);
+
+        hodo_zone_valid_count[zone_id] = valid;
+        hodo_victim_heap_index[zone_id] = -1;
+        mapping_info.valid_count += valid;
+    }
+
+    for (int zone_id = 1; zone_id <= last_data_zone; zone_id++) {
+        mapping_info.invalid_count += hodo_get_zone_invalid_count(zone_id);
+
+        hodo_victim_heap[hodo_victim_heap_size] = zone_id;
+        hodo_victim_heap_index[zone_id] = hodo_victim_heap_size;
+        hodo_victim_heap_size++;
+    }
+
+    for (int i = hodo_victim_heap_size / 2 - 1; i >= 0; i--)
+        hodo_victim_heap_fix(hodo_victim_heap[i]);
+    spin_unlock(&hodo_zone_stats_lock);
+}
+
+//다 쓴 zone 중 살아있는 블록이 가장 적은 zone. 그런 zone이 없으면 -1
+int hodo_get_GC_victim(void) {
+    int victim = -1;
+
+    spin_lock(&hodo_zone_stats_lock);
+    if (hodo_victim_heap_size > 0 && hodo_victim_key(hodo_victim_heap[0]) != U32_MAX)
+        victim = hodo_victim_heap[0];
+    spin_unlock(&hodo_zone_stats_lock);
+
+    return victim;
+}
+
+uint32_t hodo_get_zone_valid_count(int zone_id) {
+    return hodo_zone_valid_count[zone_id];
+}
+
+//한 번도 쓰이지 않은(wp보다 뒤에 있는) 데이터 zone의 수
+uint32_t hodo_get_free_zone_count(void) {
+    int last_data_zone = min(hodo_nr_zones, NUMBER_ZONES) - 3;
+
+    if (mapping_info.wp.zone_id >= last_data_zone)
+        return 0;
+
+    return last_data_zone - mapping_info.wp.zone_id;
+}
+
+//statfs에 hodo가 보는 용량을 채운다. 모든 값은 늘 유지되는 카운터에서 바로 읽으므로 자주 불러도 된다.
+//빈 블록은 지금 바로 쓸 수 있는 자리, 곧 아직 쓰지 않은 zone들과 wp zone의 남은 자리만 센다.
+//무효 블록은 GC가 돌아야 다시 쓸 수 있으므로 빼고, 그 수는 sysfs의 invalid_blocks로 알려준다. hodo_init 전이라면 아무것도 바꾸지 않는다.
+int hodo_fill_statfs(struct kstatfs *buf) {
+    int nr_data_zones = min(hodo_nr_zones, NUMBER_ZONES) - 3;
+    uint64_t blocks_per_zone = hodo_zone_size / HODO_DATABLOCK_SIZE;
+    struct hodo_block_pos wp = mapping_info.wp;
+
+    if (wp.zone_id == 0 || nr_data_zones <= 0)
+        return -EAGAIN;
+
+    buf->f_bsize = HODO_DATABLOCK_SIZE;
+    buf->f_blocks = nr_data_zones * blocks_per_zone;
+    buf->f_bfree = (uint64_t)hodo_get_free_zone_count() * blocks_per_zone;
+    if (wp.zone_id <= nr_data_zones && wp.block_index < blocks_per_zone)
+        buf->f_bfree += blocks_per_zone - wp.block_index;
+    buf->f_bavail = buf->f_bfree;
+
+    //아이노드 번호와 블록 논리 번호는 같은 번호 공간을 나누어 쓴다
+    buf->f_files = NUMBER_MAPPING_TABLE_ENTRY;
+    buf->f_ffree = hodo_get_free_logical_count();
+
+    return 0;
+}
+
+//zone에 쓰인 블록 중 더 이상 어떤 논리 번호도 가리키지 않는 블록의 수
+uint32_t hodo_get_zone_invalid_count(int zone_id) {
+    uint32_t written_blocks;
+
+    if (zone_id < mapping_info.wp.zone_id)
+        written_blocks = hodo_zone_size / HODO_DATABLOCK_SIZE;
+    else if (zone_id == mapping_info.wp.zone_id)
+        written_blocks = mapping_info.wp.block_index;
+    else
+        written_blocks = 0;
+
+    if (written_blocks < hodo_zone_valid_count[zone_id])
+        return 0;
+
+    return written_blocks - hodo_zone_valid_count[zone_id];
+}
+
+/*-------------------------------------------------------------아이노드 입출력 함수-------------------------------------------------------------------------------*/
+//inline 영역을 쓰지 않는 아이노드는 inode block의 slot 하나(HODO_INODE_CORE_SIZE)에 저장되고,
+//inline 영역을 쓰는 아이노드(작은 디렉토리)는 지금처럼 블록 하나를 통째로 쓴다.
+ssize_t hodo_read_inode(logical_block_number_t ino, struct hodo_inode *out_inode) {
+    // ZONEFS_TRACE();
+
+    uint32_t index = ino - mapping_info.starting_logical_number;
+    struct hodo_inode_block *inode_block = hodo_alloc_block();
+    ssize_t ret;
+
+    if (inode_block == NULL)
+        return -ENOMEM;
+
+    //다른 아이노드를 쓰면서 inode block이 옮겨지는 중에 옛 블록을 읽지 않도록, 표를 보고 블록을 읽는 동안 lock을 잡는다
+    mutex_lock(&hodo_inode_block_lock);
+
+    logical_block_number_t inode_block_logical_number = mapping_info.inode_block_table[index];
+
+    if (!is_block_logical_number_valid(inode_block_logical_number)) {
+        ret = hodo_read_struct(ino, out_inode, sizeof(struct hodo_inode));
+    }
+    else {
+        ret = hodo_read_struct(inode_block_logical_number, inode_block, sizeof(struct hodo_inode_block));
+        if (ret >= 0) {
+            memset(out_inode, 0, sizeof(struct hodo_inode));
+            memcpy(out_inode, inode_block->slot[mapping_info.inode_slot_table[index]], HODO_INODE_CORE_SIZE);
+            ret = sizeof(struct hodo_inode);
+        }
+    }
+
+    mutex_unlock(&hodo_inode_block_lock);
+
+    hodo_free_block(inode_block);
+    return ret;
+}
+
+//같은 아이노드를 읽어 고쳐 쓰는 쪽은 hodo_lock_inode로 서로를 막는다. 이 함수는 아이노드가 든 inode block의 다른 slot들만 지킨다.
+ssize_t hodo_write_inode(struct hodo_inode *hodo_inode) {
+    // ZONEFS_TRACE();
+
+    logical_block_number_t ino = hodo_inode->i_ino;
+    uint32_t index = ino - mapping_info.starting_logical_number;
+    struct hodo_inode_block *inode_block = hodo_alloc_block();
+    ssize_t ret;
+
+    if (inode_block == NULL)
+        return -ENOMEM;
+
+    mutex_lock(&hodo_inode_block_lock);
+
+    logical_block_number_t inode_block_logical_number = mapping_info.inode_block_table[index];
+    bool was_packed = is_block_logical_number_valid(inode_block_logical_number);
+
+    //inline 영역을 쓰는 아이노드는 블록 하나를 통째로 쓴다
+    if (!is_packable_inode(hodo_inode)) {
+        if (was_packed)
+            hodo_release_inode_slot_locked(ino);
+
+        ret = hodo_write_struct(hodo_inode, sizeof(struct hodo_inode), &ino);
+
+        mutex_unlock(&hodo_inode_block_lock);
+        hodo_free_block(inode_block);
+        return ret;
+    }
+
+    //처음 inode block에 들어가는 아이노드는 지금 채우고 있는 inode block의 빈 slot으로 간다
+    if (!was_packed)
+        inode_block_logical_number = mapping_info.current_inode_block;
+
+    int slot = -1;
+    if (is_block_logical_number_valid(inode_block_logical_number)) {
+        hodo_read_struct(inode_block_logical_number, inode_block, sizeof(struct hodo_inode_block));
+
+        if (was_packed) {
+            slot = mapping_info.inode_slot_table[index];
+        }
+        else {
+            for (int i = 0; i < HODO_INODES_PER_BLOCK; i++) {
+                if (!hodo_is_inode_slot_live(inode_block, inode_block_logical_number, i)) {
+                    slot = i;
+                    break;
+                }
+            }
+        }
+    }
+
+    //채우던 inode block이 가득 찼다면(또는 아직 없다면) 새 inode block을 시작한다
+    if (slot < 0) {
+        memset(inode_block, 0, HODO_DATABLOCK_SIZE);
+        inode_block->magic[0] = 'I';
+        inode_block->magic[1] = 'N';
+        inode_block->magic[2] = 'O';
+        inode_block->magic[3] = 'B';
+
+        inode_block_logical_number = 0;
+        slot = 0;
+    }
+
+    memcpy(inode_block->slot[slot], hodo_inode, HODO_INODE_CORE_SIZE);
+    inode_block->slot_ino[slot] = ino;
+
+    ret = hodo_write_struct(inode_block, sizeof(struct hodo_inode_block), &inode_block_logical_number);
+
+    //새 inode block에 줄 논리 번호가 없었다면 아이노드는 예전 자리에 그대로 둔다
+    if (!was_packed && is_block_logical_number_valid(inode_block_logical_number)) {
+        //예전에 블록 하나를 통째로 쓰던 아이노드였다면 그 블록은 이제 무효하다
+        hodo_drop_physical_block(ino);
+
+        mapping_info.inode_block_table[index] = inode_block_logical_number;
+        mapping_info.inode_slot_table[index] = slot;
+        mapping_info.current_inode_block = inode_block_logical_number;
+    }
+
+    mutex_unlock(&hodo_inode_block_lock);
+
+    hodo_free_block(inode_block);
+    return ret;
+}
+
+//VFS 아이노드의 모드, 소유자, 시각을 hodo 아이노드에 옮겨 쓴다. 크기와 extent는 쓰기 경로가 이미 hodo 아이노드에 써 두었다.
+int hodo_sync_inode(struct inode *inode) {
+    // ZONEFS_TRACE();
+
+    struct hodo_inode *hodo_inode = hodo_alloc_block();
+    ssize_t ret;
+
+    //writeback은 VFS의 inode lock 없이 들어오므로, 쓰기 경로나 디렉토리 연산이 고치는 중인 hodo 아이노드를 옛 내용으로 덮지 않게 한다
+    hodo_lock_inode(inode);
+
+    ret = hodo_read_inode(inode->i_ino, hodo_inode);
+    if (ret >= 0) {
+        hodo_inode->i_mode = inode->i_mode;
+        hodo_inode->i_uid = inode->i_uid;
+        hodo_inode->i_gid = inode->i_gid;
+        hodo_load_inode_times(hodo_inode, inode);
+
+        ret = hodo_write_inode(hodo_inode);
+    }
+
+    hodo_unlock_inode(inode);
+
+    hodo_free_block(hodo_inode);
+    return ret < 0 ? ret : 0;
+}
+
+//VFS 아이노드의 hodo 아이노드를 읽어 고쳐 쓰는 동안 잡는다. 잡은 채로 다른 아이노드의 lock을 잡지 않는다.
+void hodo_lock_inode(struct inode *inode) {
+    mutex_lock(&ZONEFS_I(inode)->i_hodo_mutex);
+}
+
+void hodo_unlock_inode(struct inode *inode) {
+    mutex_unlock(&ZONEFS_I(inode)->i_hodo_mutex);
+}
+
+//lazytime에서는 시각만 바뀐 VFS 아이노드를 바로 쓰지 않는다. 다른 이유로 hodo 아이노드를 새로 쓸 때 이 함수로 시각을 함께 싣는다.
+void hodo_load_inode_times(struct hodo_inode *hodo_inode, struct inode *inode) {
+    hodo_inode->i_atime = inode_get_atime(inode);
+    hodo_inode->i_mtime = inode_get_mtime(inode);
+    hodo_inode->i_ctime = inode_get_ctime(inode);
+}
+
+void hodo_release_inode_slot(logical_block_number_t ino) {
+    // ZONEFS_TRACE();
+
+    mutex_lock(&hodo_inode_block_lock);
+    hodo_release_inode_slot_locked(ino);
+    mutex_unlock(&hodo_inode_block_lock);
+}
+
+//hodo_inode_block_lock을 잡은 채로 부른다
+static void hodo_release_inode_slot_locked(logical_block_number_t ino) {
+    uint32_t index = ino - mapping_info.starting_logical_number;
+    logical_block_number_t inode_block_logical_number = mapping_info.inode_block_table[index];
+
+    if (!is_block_logical_number_valid(inode_block_logical_number))
+        return;
+
+    //slot은 매핑이 끊기는 순간 빈 slot으로 취급되므로, inode block을 새로 쓸 필요는 없다
+    mapping_info.inode_block_table[index] = 0;
+    mapping_info.inode_slot_table[index] = 0;
+
+    if (inode_block_logical_number == mapping_info.current_inode_block)
+        return;
+
+    //더 이상 살아있는 slot이 없는 inode block은 통째로 버린다
+    struct hodo_inode_block *inode_block = hodo_alloc_block();
+    if (inode_block == NULL)
+        return;
+
+    hodo_read_struct(inode_block_logical_number, inode_block, sizeof(struct hodo_inode_block));
+
+    for (int i = 0; i < HODO_INODES_PER_BLOCK; i++) {
+        if (hodo_is_inode_slot_live(inode_block, inode_block_logical_number, i)) {
+            hodo_free_block(inode_block);
+            return;
+        }
+    }
+
+    hodo_drop_physical_block(inode_block_logical_number);
+    hodo_erase_table_entry(inode_block_logical_number);
+
+    hodo_free_block(inode_block);
+}
+
+//링크가 모두 끊긴 아이노드를 마지막 iput에서 지운다. 아이노드가 가리키던 데이터블록, extent leaf, dirent 블록과 아이노드 자신을 모두 풀어준다.
+//지운 아이노드를 i_nlink 0으로 다시 쓰지 않으므로, 지운 파일 때문에 새로 유효해지는 블록은 없다.
+void hodo_evict_inode(logical_block_number_t ino) {
+    // ZONEFS_TRACE();
+
+    struct hodo_inode *hodo_inode = hodo_alloc_block();
+
+    if (hodo_read_inode(ino, hodo_inode) < 0) {
+        hodo_free_block(hodo_inode);
+        return;
+    }
+
+    if (hodo_inode->type == HODO_TYPE_REG)
+        hodo_extent_truncate(hodo_inode, 0);
+    else if (hodo_inode->type == HODO_TYPE_DIR && !is_inline_dir(hodo_inode))
+        hodo_release_dir_blocks(hodo_inode);
+
+    hodo_release_inode_slot(ino);
+    hodo_drop_physical_block(ino);
+    hodo_erase_table_entry(ino);
+
+    hodo_free_block(hodo_inode);
+}
+
+//디렉토리의 direct 블록들과 indirect 블록이 가리키는 블록들을 모두 풀어준다
+static void hodo_release_dir_blocks(struct hodo_inode *dir_hodo_inode) {
+    for (int i = 0; i < 10; i++) {
+        if (is_block_logical_number_valid(dir_hodo_inode->direct[i]))
+            hodo_release_logical_range(dir_hodo_inode->direct[i], 1);
+    }
+
+    logical_block_number_t indirect_block_logical_number[3] = {
+        dir_hodo_inode->single_indirect,
+        dir_hodo_inode->double_indirect,
+        dir_hodo_inode->triple_indirect
+    };
+
+    for (int i = 0; i < 3; i++) {
+        if (is_block_logical_number_valid(indirect_block_logical_number[i]))
+            hodo_release_indirect_block(indirect_block_logical_number[i]);
+    }
 }
 
-int remove_dirent_from_indirect_block(
-    struct hodo_datablock *indirect_block,
-    const char *target_name,
-    logical_block_number_t *out_logical_number
-) {
-    // ZONEFS_TRACE();
-
+static void hodo_release_indirect_block(logical_block_number_t indirect_block_logical_number) {
+    struct hodo_datablock *indirect_block = hodo_alloc_block();
+    struct hodo_datablock *temp_block = hodo_alloc_block();
     logical_block_number_t temp_block_logical_number;
-    struct hodo_datablock *temp_block = kmalloc(HODO_DATABLOCK_SIZE, GFP_KERNEL);
 
-    if (temp_block == NULL) {
-        // pr_info("zonefs: (error in hodo_unlink) cannot allocate 4KB heap space for datablock variable\n");
-        return NOTHING_FOUND;
-    }
+    hodo_read_struct(indirect_block_logical_number, indirect_block, HODO_DATABLOCK_SIZE);
 
     for (int j = HODO_DATA_START; j < HODO_DATABLOCK_SIZE - BLOCK_PTR_SZ; j += BLOCK_PTR_SZ) {
         memcpy(&temp_block_logical_number, (void*)indirect_block + j, BLOCK_PTR_SZ);
 
-        if(!is_block_logical_number_valid(temp_block_logical_number))  
+        if (!is_block_logical_number_valid(temp_block_logical_number))
             continue;
 
         hodo_read_struct(temp_block_logical_number, temp_block, HODO_DATABLOCK_SIZE);
 
-        int result;
-        logical_block_number_t written_logical_number = temp_block_logical_number;
-
-        if(is_directblock(temp_block))
-            result = remove_dirent_from_direct_block(temp_block, target_name, &written_logical_number);
-
-        else 
-            result = remove_dirent_from_indirect_block(temp_block, target_name, &written_logical_number);
-
-        if (result != NOTHING_FOUND && is_block_logical_number_valid(written_logical_number)){
-            //dirent를 삭제하면서 direct_datablock가 새로 써지므로, 이를 가리키는 indirect_datablock도 거슬러 올라가며 새로 써져야 한다.
-            memcpy((void*)indirect_block + j, &written_logical_number, BLOCK_PTR_SZ);
-            hodo_write_struct(indirect_block, sizeof(struct hodo_datablock), out_logical_number);
-
-            kfree(temp_block);
-            return result;
-        }
+        if (is_directblock(temp_block))
+            hodo_release_logical_range(temp_block_logical_number, 1);
+        else
+            hodo_release_indirect_block(temp_block_logical_number);
     }
 
-    kfree(temp_block);
-    return NOTHING_FOUND;
+    hodo_release_logical_range(indirect_block_logical_number, 1);
+
+    hodo_free_block(temp_block);
+    hodo_free_block(indirect_block);
 }
 
-/*-------------------------------------------------------------rmdir용 함수 선언--------------------------------------------------------------------------------*/
-bool check_directory_empty(struct dentry *dentry){
-    // ZONEFS_TRACE();
-    
-    //디렉토리가 루트 디록테리면 매핑 테이블에서 인덱스를 아이노드 번호가 아니라, 0번을 이용해야 하므로 루트 디렉토리인지를 확인한다.
-    uint64_t dir_mapping_index;
+static bool hodo_is_inode_slot_live(struct hodo_inode_block *inode_block, logical_block_number_t inode_block_logical_number, int slot) {
+    logical_block_number_t ino = inode_block->slot_ino[slot];
+    uint32_t index = ino - mapping_info.starting_logical_number;
 
-    if(dentry->d_inode == dentry->d_sb->s_root->d_inode) {
-        dir_mapping_index = mapping_info.starting_logical_number;
-    }
-    else {
-        dir_mapping_index = dentry->d_inode->i_ino;
-    }
+    if (!is_block_logical_number_valid(ino))
+        return false;
 
-    //디렉토리의 hodo 아이노드를 저장장치로부터 읽어온다
-    logical_block_number_t dir_hodo_logical_number= dir_mapping_index;
-    struct hodo_inode dir_hodo_inode;
-    hodo_read_struct(dir_hodo_logical_number, &dir_hodo_inode, sizeof(struct hodo_inode));
+    return mapping_info.inode_block_table[index] == inode_block_logical_number &&
+           mapping_info.inode_slot_table[index] == slot;
+}
 
-    //디렉토리 hodo 아이노드가 가리키는 데이터블록들을 순회할 준비를 한다
-    struct hodo_datablock *buf_block = kmalloc(HODO_DATABLOCK_SIZE, GFP_KERNEL);
+static void hodo_drop_physical_block(logical_block_number_t logical_block_number) {
+    struct hodo_block_pos *block_pos = &mapping_info.mapping_table[logical_block_number - mapping_info.starting_logical_number];
 
-    if (buf_block == NULL) {
-        // pr_info("zonefs: (error in hodo_sub_readdir) cannot allocate 4KB heap space for datablock variable\n");
-        return EMPTY_CHECKED;
-    }
+    hodo_trans_forget(logical_block_number);
 
-    int result;
+    if (block_pos->zone_id == 0)
+        return;
 
-    //direct data block들이 비워져있는지 확인하기
-    logical_block_number_t direct_block_logical_number;
+    hodo_unset_GC_bitmap(*block_pos);
+    block_pos->zone_id = 0;
+    block_pos->block_index = 0;
+}
 
-    for (int i = 0; i < 10; i++) {
-        direct_block_logical_number = dir_hodo_inode.direct[i];
-        
-        if(is_block_logical_number_valid(direct_block_logical_number)) {
+/*-------------------------------------------------------------트랜잭션용 함수-------------------------------------------------------------------------------*/
+//연산 하나를 트랜잭션에 넣는다. 이 태스크가 hodo_trans_end를 부를 때까지 쓰는 블록은 장치로 바로 가지 않고 모인다. 중첩해서 열지 않는다.
+//handle은 hodo_trans_end까지 호출한 쪽이 들고 있다. 다른 파일시스템의 것인 current->journal_info는 건드리지 않는다.
+void hodo_trans_begin(struct hodo_trans_handle *handle) {
+    // ZONEFS_TRACE();
 
-            hodo_read_struct(direct_block_logical_number, buf_block, HODO_DATABLOCK_SIZE);
+    handle->task = current;
 
-            result = check_directory_empty_from_direct_block(buf_block);
-            
-            if(result != EMPTY_CHECKED) {
-                kfree(buf_block);
-                return result;
-            }
-        }
-    }
+    mutex_lock(&hodo_trans.lock);
+    WARN_ON_ONCE(hodo_trans_in_task_locked());
+    list_add(&handle->list, &hodo_trans.handles);
+    WRITE_ONCE(hodo_trans.users, hodo_trans.users + 1);
+    mutex_unlock(&hodo_trans.lock);
+}
 
-    //single, double, triple indirect data block를 통해 간접적으로 가리키는 direct_data_block들이 비워져있는지 확인하기
-    logical_block_number_t indirect_block_logical_number[3] = {
-        dir_hodo_inode.single_indirect,
-        dir_hodo_inode.double_indirect,
-        dir_hodo_inode.triple_indirect
-    };
+//연산을 트랜잭션에서 뺀다. 마지막으로 빠지는 연산이 그동안 함께 열려 있던 연산들의 블록까지 모두 커밋한다.
+void hodo_trans_end(struct hodo_trans_handle *handle) {
+    // ZONEFS_TRACE();
 
-    for(int i = 0; i < 3; i++){
-        if(is_block_logical_number_valid(indirect_block_logical_number[i])) {
-            hodo_read_struct(indirect_block_logical_number[i], buf_block, HODO_DATABLOCK_SIZE);
+    mutex_lock(&hodo_trans.lock);
+    list_del(&handle->list);
+    WRITE_ONCE(hodo_trans.users, hodo_trans.users - 1);
+    if (hodo_trans.users == 0)
+        hodo_trans_commit_locked();
+    mutex_unlock(&hodo_trans.lock);
+}
 
-            result = check_directory_empty_from_indirect_block(buf_block);
+//지금 태스크가 연 트랜잭션이 있는지 본다. hodo_trans.lock을 잡은 채로 부른다.
+static bool hodo_trans_in_task_locked(void) {
+    struct hodo_trans_handle *handle;
 
-            if(result != EMPTY_CHECKED) {
-                kfree(buf_block);
-                return result;
-            }
-        }
+    list_for_each_entry(handle, &hodo_trans.handles, list) {
+        if (handle->task == current)
+            return true;
     }
 
-    //모두 잘 다 뒤져보았으므로 더 읽을 필요가 없음을 알려주기 위해 EMPTY_CHECKED를 반환하고 끝낸다
-    kfree(buf_block);
-    return EMPTY_CHECKED;
+    return false;
 }
 
-bool check_directory_empty_from_direct_block(struct hodo_datablock *direct_block){
+//열린 연산이 남아 있더라도 지금까지 모인 블록을 바로 쓴다. 쓰지 못한 블록이 남았다면 오류를 반환한다.
+int hodo_trans_commit(void) {
     // ZONEFS_TRACE();
 
-    const char zero[HODO_DATABLOCK_SIZE - HODO_DATA_START] = {0};
+    int ret;
 
-    if(memcmp(direct_block->data, zero, HODO_DATABLOCK_SIZE - HODO_DATA_START) == 0)
-        return EMPTY_CHECKED;
-    else
-        return !EMPTY_CHECKED;
+    mutex_lock(&hodo_trans.lock);
+    ret = hodo_trans_commit_locked();
+    mutex_unlock(&hodo_trans.lock);
+
+    return ret;
 }
 
-bool check_directory_empty_from_indirect_block(struct hodo_datablock *indirect_block){
+//언마운트할 때 쓰지 못하고 남은 블록들을 버린다. 이때는 마운트 경로로 zone 파일을 열 수 없어 커밋할 수 없고,
+//그대로 두면 다음 마운트의 첫 커밋이 이 블록들을 새 파일시스템에 쓰게 된다.
+void hodo_trans_discard(void) {
     // ZONEFS_TRACE();
 
-    logical_block_number_t temp_block_logical_number;
-    struct hodo_datablock *temp_block = kmalloc(HODO_DATABLOCK_SIZE, GFP_KERNEL);
+    mutex_lock(&hodo_trans.lock);
+    if (hodo_trans.count)
+        pr_err("zonefs: dropping %d hodo metadata blocks that were never committed\n", hodo_trans.count);
 
-    if (temp_block == NULL) {
-        // pr_info("zonefs: (error in hodo_sub_lookup) cannot allocate 4KB heap space for datablock variable\n");
-        return EMPTY_CHECKED;
-    }
+    for (int i = 0; i < hodo_trans.count; i++)
+        hodo_free_block(hodo_trans.block[i]);
+    WRITE_ONCE(hodo_trans.count, 0);
+    mutex_unlock(&hodo_trans.lock);
+}
 
-    for (int j = HODO_DATA_START; j < HODO_DATABLOCK_SIZE - BLOCK_PTR_SZ; j += BLOCK_PTR_SZ) {
-        memcpy(&temp_block_logical_number, (void*)indirect_block + j, BLOCK_PTR_SZ);
+static int hodo_trans_find(logical_block_number_t logical_block_number) {
+    for (int i = 0; i < hodo_trans.count; i++) {
+        if (hodo_trans.logical_block_number[i] == logical_block_number)
+            return i;
+    }
 
-        if(!is_block_logical_number_valid(temp_block_logical_number))
-            continue;
+    return -1;
+}
 
-        hodo_read_struct(temp_block_logical_number, temp_block, HODO_DATABLOCK_SIZE);
+//트랜잭션 안에서 쓰는 블록은 장치 대신 모아 둔 사본에 쓴다. 같은 블록을 여러 번 고쳐도 커밋 때는 마지막 내용 한 번만 쓰인다.
+//트랜잭션 밖의 쓰기라도 이미 모여 있는 블록이라면 함께 모은다. 장치에 따로 쓰면 나중의 커밋이 그 내용을 옛 사본으로 덮어 버리기 때문이다.
+//GC가 장치의 옛 내용을 옮겨 쓰는 것은 새 내용이 아니므로 여기를 거치지 않고 hodo_write_block_locked로 바로 쓴다.
+static bool hodo_trans_stage(void *buf, size_t len, logical_block_number_t logical_block_number) {
+    bool in_trans;
+    int index;
 
-        uint64_t result;
+    //열린 트랜잭션도, 모아 둔 블록도 없다면 lock 없이 바로 장치에 쓰게 한다
+    if (!READ_ONCE(hodo_trans.users) && !READ_ONCE(hodo_trans.count))
+        return false;
 
-        if(is_directblock(temp_block))
-            result = check_directory_empty_from_direct_block(temp_block);
+    mutex_lock(&hodo_trans.lock);
+    in_trans = hodo_trans_in_task_locked();
 
-        else 
-            result = check_directory_empty_from_indirect_block(temp_block);
+    index = hodo_trans_find(logical_block_number);
+    if (index < 0) {
+        if (!in_trans) {
+            mutex_unlock(&hodo_trans.lock);
+            return false;
+        }
 
-        if (result != EMPTY_CHECKED){
-            kfree(temp_block);
-            return result;
+        //자리가 다 찼다면 지금까지 모인 블록을 먼저 쓰고 다시 모은다. 커밋이 실패해 자리가 나지 않았다면 이 블록은 장치에 바로 쓴다.
+        if (hodo_trans.count == HODO_TRANS_MAX_BLOCKS)
+            hodo_trans_commit_locked();
+        if (hodo_trans.count == HODO_TRANS_MAX_BLOCKS) {
+            mutex_unlock(&hodo_trans.lock);
+            return false;
         }
+
+        index = hodo_trans.count;
+        hodo_trans.logical_block_number[index] = logical_block_number;
+        hodo_trans.block[index] = hodo_alloc_block();
+        WRITE_ONCE(hodo_trans.count, index + 1);
     }
 
-    kfree(temp_block);
-    return EMPTY_CHECKED;
-}
+    memcpy(hodo_trans.block[index], buf, len);
+    memset(hodo_trans.block[index] + len, 0, HODO_DATABLOCK_SIZE - len);
 
-/*-------------------------------------------------------------비트맵용 함수-------------------------------------------------------------------------------*/
-static void hodo_set_logical_bitmap(int i, int j) {
-    mapping_info.logical_entry_bitmap[i] |= (1 << (31 - j));
+    mutex_unlock(&hodo_trans.lock);
+    return true;
 }
 
-static void hodo_unset_logical_bitmap(int i, int j) {
-    mapping_info.logical_entry_bitmap[i] &= ~(1 << (31 - j));
-}
+//커밋을 기다리는 블록이라면 그 사본을 읽어 준다. 아직 매핑 테이블에는 옛 위치가 남아 있기 때문이다.
+static bool hodo_trans_read(logical_block_number_t logical_block_number, void *out_buf, size_t len) {
+    bool found = false;
+    int index;
 
-int hodo_get_next_logical_number(void) {
-    for (int i = 0; i < (NUMBER_MAPPING_TABLE_ENTRY / 32); ++i) {
-        if (mapping_info.logical_entry_bitmap[i] != 0xFFFFFFFF) {
-            for (int j = 0; j < 32; ++j) {
-                if ((mapping_info.logical_entry_bitmap[i] & (1 << (31 - j))) == 0) {
-                    hodo_set_logical_bitmap(i, j);
-                    // pr_info("return logical number : %d\n", mapping_info.starting_logical_number + (i * 32 + j));
-                    return mapping_info.starting_logical_number + (i * 32 + j);
-                }
-            }
-        }
+    if (!READ_ONCE(hodo_trans.count))
+        return false;
+
+    mutex_lock(&hodo_trans.lock);
+    index = hodo_trans_find(logical_block_number);
+    if (index >= 0) {
+        memcpy(out_buf, hodo_trans.block[index], len);
+        found = true;
     }
-    return -1;
+    mutex_unlock(&hodo_trans.lock);
+
+    return found;
 }
 
-static void hodo_set_GC_bitmap(struct hodo_block_pos physical_address) {
-    int zone_id = physical_address.zone_id;
-    int block_index = physical_address.block_index;
+//풀리는 논리 번호가 모여 있다면 빼낸다. 그대로 두면 커밋이 이미 풀린 논리 번호를 다시 매핑한다.
+static void hodo_trans_forget(logical_block_number_t logical_block_number) {
+    int index;
+
+    if (!READ_ONCE(hodo_trans.count))
+        return;
 
-    //pr_info("set zone is over one : %d\n", zone_id);
-    if(zone_id == 1) zone_1_valid_set_count++;
-    else if(zone_id == 2) zone_2_valid_set_count++;
+    mutex_lock(&hodo_trans.lock);
+    index = hodo_trans_find(logical_block_number);
+    if (index >= 0) {
+        int last = hodo_trans.count - 1;
 
-    mapping_info.GC_bitmap[zone_id][block_index / 32] |= (1 << (31 - (block_index % 32)));
+        hodo_free_block(hodo_trans.block[index]);
+        hodo_trans.logical_block_number[index] = hodo_trans.logical_block_number[last];
+        hodo_trans.block[index] = hodo_trans.block[last];
+        WRITE_ONCE(hodo_trans.count, last);
+    }
+    mutex_unlock(&hodo_trans.lock);
 }
 
-static void hodo_unset_GC_bitmap(struct hodo_block_pos physical_address) {
-    int zone_id = physical_address.zone_id;
-    int block_index = physical_address.block_index;
+//모인 블록들을 wp부터 이어서 쓴다. 한 zone 안에 이어지는 블록들은 write 한 번으로 보내고, zone 끝에 닿으면 다음 zone에서 이어서 쓴다.
+//zone 쓰기가 실패하면 끝까지 쓰인 블록만 매핑하고, 나머지는 모인 채로 남겨 두고 오류를 반환한다. 남은 블록은 다음 커밋이 다시 쓴다.
+static int hodo_trans_commit_locked(void) {
+    int count = hodo_trans.count;
+    int done = 0;
+    int err = 0;
+
+    mutex_lock(&hodo_wp_lock);
+    while (done < count) {
+        struct hodo_block_pos block_pos = mapping_info.wp;
+        uint32_t room = hodo_zone_size / HODO_DATABLOCK_SIZE - block_pos.block_index;
+        int nr = min_t(int, count - done, room);
+        struct iov_iter iter;
+        ssize_t ret;
+        int written;
+
+        for (int i = 0; i < nr; i++) {
+            hodo_trans.kvec[i].iov_base = hodo_trans.block[done + i];
+            hodo_trans.kvec[i].iov_len = HODO_DATABLOCK_SIZE;
+        }
 
+        iov_iter_kvec(&iter, ITER_SOURCE, hodo_trans.kvec, nr, (size_t)nr * HODO_DATABLOCK_SIZE);
 
-    if(zone_id == 1) zone_1_valid_unset_count++;
-    else if(zone_id == 2) zone_2_valid_unset_count++;
+        uint64_t start_ns = ktime_get_ns();
 
-    mapping_info.GC_bitmap[zone_id][block_index / 32] &= ~(1 << (31 - (block_index % 32)));
-}
+        ret = hodo_write_zone_iter(block_pos, &iter);
 
-static struct hodo_block_pos hodo_get_next_GC_valid(void) {
-    struct hodo_block_pos start_pos = mapping_info.wp;
-    struct hodo_block_pos ret = {0,0}; 
+        trace_hodo_trans_commit(block_pos, nr, ret, ktime_get_ns() - start_ns);
 
-    for (int i = start_pos.zone_id; i < NUMBER_ZONES - 2; ++i) {
-        for (int j = 0; j < (BLOCKS_PER_ZONE / 32); ++j) {
-            if (mapping_info.GC_bitmap[i][j] != 0x00000000) {
-                for (int k = 0; k < 32; ++k) {
-                    if ((mapping_info.GC_bitmap[i][j] & (1 << (31 - k))) != 0) {
-                        ret.zone_id = i;
-                        ret.block_index = (j * 32) + k;
-                        // pr_info("GC bitmap return value: (%d,%d)\n", ret.zone_id, ret.block_index);
-                        if(ret.zone_id == 1) zone_1_valid_count++;
-                        else if(ret.zone_id == 2) zone_2_valid_count++;
-                        //pr_info("count is : %d / set zone number : %d\n", valid_cnt++, ret.zone_id);
-                        return ret;
-                    }
-                }
-            }
+        written = ret > 0 ? ret / HODO_DATABLOCK_SIZE : 0;
+        for (int i = 0; i < written; i++) {
+            struct hodo_block_pos pos = {
+                .zone_id = block_pos.zone_id,
+                .block_index = block_pos.block_index + i,
+            };
+
+            hodo_map_block(hodo_trans.logical_block_number[done + i], pos);
+        }
+
+        //블록 중간에서 끊긴 쓰기도 zone의 쓰기 위치는 옮겼으므로 wp는 걸친 블록까지 옮긴다
+        if (ret > 0)
+            hodo_advance_wp(DIV_ROUND_UP(ret, HODO_DATABLOCK_SIZE));
+        done += written;
+
+        if (written < nr) {
+            pr_err("zonefs: hodo transaction commit of %d blocks at %u:%u failed (%zd)\n",
+                   nr, block_pos.zone_id, block_pos.block_index, ret);
+            err = ret < 0 ? ret : -EIO;
+            break;
         }
     }
+    mutex_unlock(&hodo_wp_lock);
 
-    return ret;
-}
+    for (int i = 0; i < done; i++)
+        hodo_free_block(hodo_trans.block[i]);
 
-int hodo_erase_table_entry(int table_entry_index) {
-    mapping_info.mapping_table[table_entry_index - mapping_info.starting_logical_number].zone_id = 0;  // check invalid
-    hodo_unset_logical_bitmap(table_entry_index/32, table_entry_index%32);
-    return 0;
+    //쓰지 못한 블록들은 앞으로 당겨서 모인 채로 둔다
+    for (int i = done; i < count; i++) {
+        hodo_trans.logical_block_number[i - done] = hodo_trans.logical_block_number[i];
+        hodo_trans.block[i - done] = hodo_trans.block[i];
+    }
+
+    if (done) {
+        hodo_stat_inc(HODO_STAT_TRANS_COMMITS);
+        hodo_stat_add(HODO_STAT_TRANS_BLOCKS, done);
+    }
+    WRITE_ONCE(hodo_trans.count, count - done);
+
+    return err;
 }
 
 /*-------------------------------------------------------------입출력 함수-------------------------------------------------------------------------------*/
@@ -1304,6 +3395,10 @@ ssize_t hodo_read_struct(logical_block_number_t logical_block_number, void *out_
     if (!out_buf || len == 0 || len > HODO_DATABLOCK_SIZE)
         return -EINVAL;
 
+    //커밋을 기다리는 블록이라면 장치 대신 트랜잭션에 모아 둔 사본을 읽는다
+    if (hodo_trans_read(logical_block_number, out_buf, len))
+        return len;
+
     //seq 파일을 열기 위해 경로 이름(path) 만들기
     const char path_up[16];
     char path_down[6] = {0, };
@@ -1343,91 +3438,146 @@ ssize_t hodo_read_struct(logical_block_number_t logical_block_number, void *out_
         return ret;
     }
 
+    uint64_t start_ns = ktime_get_ns();
+
     ret = zone_file->f_op->read_iter(&kiocb, &iter);
 
     filp_close(zone_file, NULL);
+
+    hodo_latency_record(HODO_LAT_DEVICE_READ, start_ns);
+    trace_hodo_read_struct(logical_block_number, block_pos, len, ret, ktime_get_ns() - start_ns);
     return ret;
 }
 
 ssize_t hodo_write_struct(void *buf, size_t len, logical_block_number_t *logical_block_number) {
     // ZONEFS_TRACE();
 
-    uint32_t zone_id = mapping_info.wp.zone_id;
-    uint64_t offset = mapping_info.wp.block_index * HODO_DATABLOCK_SIZE;
+    ssize_t ret;
 
     if (!buf || len == 0 || len > HODO_DATABLOCK_SIZE)
         return -EINVAL;
 
-    hodo_set_GC_bitmap(mapping_info.wp);
     if(*logical_block_number == 0){
-        *logical_block_number = hodo_get_next_logical_number();
-    }
-    else {  // unset GC bitmap
-        struct hodo_block_pos invalid_pos = mapping_info.mapping_table[*logical_block_number - mapping_info.starting_logical_number];
-        hodo_unset_GC_bitmap(invalid_pos);
-    }
-
-    mapping_info.mapping_table[*logical_block_number - mapping_info.starting_logical_number] = mapping_info.wp;
+        int new_logical_number = hodo_get_next_logical_number();
 
-    if (((char*)buf)[0] == 'D' && ((char*)buf)[1] == 'A' && ((char*)buf)[2] == 'T') {
-        // pr_info("logical block number: %d\n", *logical_block_number);
-        ((struct hodo_datablock*)buf)->logical_block_number = *logical_block_number;
+        if (new_logical_number < 0)
+            return new_logical_number;
+        *logical_block_number = new_logical_number;
     }
 
-    //seq 파일을 열기 위해 경로 이름(path) 만들기
-    const char path_up[16];
-    char path_down[6] = {0, };
+    //트랜잭션 안이라면 장치에 쓰지 않고 모아 둔다. 매핑은 커밋할 때 정해진다.
+    if (hodo_trans_stage(buf, len, *logical_block_number))
+        return len;
 
-    memcpy(path_up, mount_point_path, sizeof(path_up));
-    strcat(path_up, "/seq/");
-    snprintf(path_down, sizeof(path_down), "%d", zone_id);
-    const char *path = strncat(path_up, path_down, 6);
+    mutex_lock(&hodo_wp_lock);
+    ret = hodo_write_block_locked(buf, len, *logical_block_number);
+    mutex_unlock(&hodo_wp_lock);
 
-    struct file *zone_file;
-    struct kiocb kiocb;
+    return ret;
+}
+
+//hodo_wp_lock을 잡고 호출한다. 블록 하나를 wp 위치에 쓰고 논리 번호를 그 위치로 옮긴다.
+static ssize_t hodo_write_block_locked(void *buf, size_t len, logical_block_number_t logical_block_number) {
+    struct hodo_block_pos block_pos = mapping_info.wp;
     struct iov_iter iter;
     struct kvec kvec;
     ssize_t ret;
 
-    //파일 열기
-    zone_file = filp_open(path, O_WRONLY | O_LARGEFILE, 0);
-    if (IS_ERR(zone_file)) {
-        pr_err("zonefs: filp_open(%s) failed\n", path);
-        return PTR_ERR(zone_file);
-    }
+    hodo_map_block(logical_block_number, block_pos);
 
     //iov_iter 구성
     kvec.iov_base = (void*)buf;
     kvec.iov_len = len;
     iov_iter_kvec(&iter, ITER_SOURCE, &kvec, 1, len);
 
+    uint64_t start_ns = ktime_get_ns();
+
+    ret = hodo_write_zone_iter(block_pos, &iter);
+
+    trace_hodo_write_struct(logical_block_number, block_pos, len, ret, ktime_get_ns() - start_ns);
+
+    hodo_advance_wp(1);
+
+    return ret;
+}
+
+//block_pos 위치부터 iter의 내용을 seq zone 파일에 direct I/O로 쓴다. iter가 사용자 버퍼라면 사용자 페이지에서 바로 장치로 간다.
+ssize_t hodo_write_zone_iter(struct hodo_block_pos block_pos, struct iov_iter *iter) {
+    // ZONEFS_TRACE();
+
+    struct file *zone_file;
+    struct kiocb kiocb;
+    char path_buf[32];
+    ssize_t ret;
+
+    //seq 파일을 열기 위해 경로 이름(path) 만들기
+    scnprintf(path_buf, sizeof(path_buf), "%s/seq/%d", mount_point_path, block_pos.zone_id);
+
+    //파일 열기
+    zone_file = filp_open(path_buf, O_WRONLY | O_LARGEFILE, 0);
+    if (IS_ERR(zone_file)) {
+        pr_err("zonefs: filp_open(%s) failed\n", path_buf);
+        return PTR_ERR(zone_file);
+    }
+
     //kiocb 구성
     init_sync_kiocb(&kiocb, zone_file);
-    kiocb.ki_pos = offset;
+    kiocb.ki_pos = (loff_t)block_pos.block_index * HODO_DATABLOCK_SIZE;
     kiocb.ki_flags = IOCB_DIRECT;
 
-    // pr_info("path: %s\toffset: %ld\n", path, offset);
     //위 두 정보를 가지고 write_iter 실행
     if (!(zone_file->f_op) || !(zone_file->f_op->write_iter)) {
-        pr_err("zonefs: read_iter not available on file\n");
+        pr_err("zonefs: write_iter not available on file\n");
         filp_close(zone_file, NULL);
-        ret = -EINVAL;
+        return -EINVAL;
     }
 
-    ret = zone_file->f_op->write_iter(&kiocb, &iter);
+    uint64_t start_ns = ktime_get_ns();
+
+    ret = zone_file->f_op->write_iter(&kiocb, iter);
     filp_close(zone_file, NULL);
 
-    if (offset + len == hodo_zone_size) {
-        pr_info("hodo_write_struct wp is moved!\n");
-        mapping_info.wp.zone_id = zone_id + 1; 
+    hodo_latency_record(HODO_LAT_DEVICE_WRITE, start_ns);
+
+    if (ret > 0)
+        hodo_stat_add(HODO_STAT_DEVICE_BYTES_WRITTEN, ret);
+
+    return ret;
+}
+
+//논리 번호 logical_block_number가 이제 block_pos에 있다고 기록하고, 이전 위치는 GC 대상에서 뺀다
+static void hodo_map_block(logical_block_number_t logical_block_number, struct hodo_block_pos block_pos) {
+    struct hodo_block_pos *mapping = &mapping_info.mapping_table[logical_block_number - mapping_info.starting_logical_number];
+
+    trace_hodo_remap(logical_block_number, *mapping, block_pos);
+
+    hodo_set_GC_bitmap(block_pos);
+
+    //미리 할당만 받고 아직 한 번도 쓰이지 않은 논리 번호는 무효화할 이전 위치가 없다
+    if (mapping->zone_id != 0)
+        hodo_unset_GC_bitmap(*mapping);
+
+    *mapping = block_pos;
+    mapping_info.zone_summary[block_pos.zone_id][block_pos.block_index] = logical_block_number;
+}
+
+//hodo_wp_lock을 잡고 호출한다. wp를 nr_blocks만큼 옮긴다. zone 끝에 닿으면 다음 zone의 처음으로 넘어간다.
+static void hodo_advance_wp(uint32_t nr_blocks) {
+    uint64_t next_offset = (uint64_t)(mapping_info.wp.block_index + nr_blocks) * HODO_DATABLOCK_SIZE;
+
+    if (next_offset >= hodo_zone_size) {
+        trace_hodo_wp_switch(mapping_info.wp.zone_id, mapping_info.wp.zone_id + 1, hodo_get_zone_valid_count(mapping_info.wp.zone_id));
+
+        //heap의 key가 wp zone을 보므로 wp zone과 heap을 함께 바꾼다. 다 쓴 zone이 이제 GC victim 후보가 된다.
+        spin_lock(&hodo_zone_stats_lock);
+        mapping_info.wp.zone_id += 1;
         mapping_info.wp.block_index = 0;
+        hodo_victim_heap_fix(mapping_info.wp.zone_id - 1);
+        spin_unlock(&hodo_zone_stats_lock);
     }
     else {
-        mapping_info.wp.zone_id = zone_id; 
-        mapping_info.wp.block_index += 1;
+        mapping_info.wp.block_index += nr_blocks;
     }
-
-    return ret;
 }
 
 static ssize_t hodo_GC_write_struct(void *buf, size_t len, logical_block_number_t *logical_block_number) {
@@ -1442,8 +3592,10 @@ static ssize_t hodo_GC_write_struct(void *buf, size_t len, logical_block_number_
     hodo_set_GC_bitmap(mapping_info.swap_wp);
     struct hodo_block_pos invalid_pos = mapping_info.mapping_table[*logical_block_number - mapping_info.starting_logical_number];
     hodo_unset_GC_bitmap(invalid_pos);
+    trace_hodo_remap(*logical_block_number, invalid_pos, mapping_info.swap_wp);
 
     mapping_info.mapping_table[*logical_block_number - mapping_info.starting_logical_number] = mapping_info.swap_wp;
+    mapping_info.zone_summary[mapping_info.swap_wp.zone_id][mapping_info.swap_wp.block_index] = *logical_block_number;
 
     //seq 파일을 열기 위해 경로 이름(path) 만들기
     const char path_up[16];
@@ -1485,9 +3637,16 @@ static ssize_t hodo_GC_write_struct(void *buf, size_t len, logical_block_number_
         ret = -EINVAL;
     }
 
+    uint64_t start_ns = ktime_get_ns();
+
     ret = zone_file->f_op->write_iter(&kiocb, &iter);
     filp_close(zone_file, NULL);
 
+    hodo_latency_record(HODO_LAT_DEVICE_WRITE, start_ns);
+
+    if (ret > 0)
+        hodo_stat_add(HODO_STAT_DEVICE_BYTES_WRITTEN, ret);
+
     if (offset + len != hodo_zone_size) {
         mapping_info.swap_wp.zone_id = zone_id; 
         mapping_info.swap_wp.block_index += 1;
@@ -1544,14 +3703,18 @@ static ssize_t hodo_GC_read_struct(struct hodo_block_pos block_pos, void *out_bu
         return ret;
     }
 
+    uint64_t start_ns = ktime_get_ns();
+
     ret = zone_file->f_op->read_iter(&kiocb, &iter);
 
     filp_close(zone_file, NULL);
+
+    hodo_latency_record(HODO_LAT_DEVICE_READ, start_ns);
     return ret;
 }
 
 ssize_t compact_datablock(struct hodo_datablock *source_block, int remove_start_index, int remove_size, logical_block_number_t *out_logical_number){
-    struct hodo_datablock *temp_block = kmalloc(HODO_DATABLOCK_SIZE, GFP_KERNEL);
+    struct hodo_datablock *temp_block = hodo_alloc_block();
     int remove_end_index = remove_start_index + remove_size;
 
     //(0~remove_start_index) 사이의 내용을 temp_block으로 옮긴다
@@ -1561,7 +3724,7 @@ ssize_t compact_datablock(struct hodo_datablock *source_block, int remove_start_
 
     ssize_t size = hodo_write_struct(temp_block, sizeof(struct hodo_datablock), out_logical_number);
     
-    kfree(temp_block);
+    hodo_free_block(temp_block);
     return size;
 }
 
@@ -1621,18 +3784,55 @@ bool is_dirent_valid(struct hodo_dirent *dirent){
         dirent->name_len != 0 &&
         dirent->i_ino != 0 &&
         (dirent->file_type == HODO_TYPE_DIR ||
-        dirent->file_type == HODO_TYPE_REG)
+        dirent->file_type == HODO_TYPE_REG ||
+        dirent->file_type == HODO_TYPE_LNK)
     )   
         return true;
     else
         return false;
 }
 
+bool is_dirent_name_equal(struct hodo_dirent *dirent, const char *target_name){
+    size_t target_len = strnlen(target_name, HODO_MAX_NAME_LEN + 1);
+
+    if(!is_dirent_valid(dirent) || dirent->name_len != target_len)
+        return false;
+
+    return memcmp(dirent->name, target_name, target_len) == 0;
+}
+
+bool is_inline_dir(struct hodo_inode *hodo_inode){
+    if(hodo_inode->type == HODO_TYPE_DIR && (hodo_inode->i_flags & HODO_INODE_INLINE_DIRENT)) return true;
+    else return false;
+}
+
 bool is_block_logical_number_valid(logical_block_number_t logical_block_number){
     if(logical_block_number != 0) return true;
     else return false;
 }
 
+bool is_packable_inode(struct hodo_inode *hodo_inode){
+    if(hodo_inode->i_flags & (HODO_INODE_INLINE_DIRENT | HODO_INODE_INLINE_LINK)) return false;
+    else return true;
+}
+
+//GC가 옮기는 블록이 어느 논리 번호의 블록인지 알아낸다. 블록 내용에는 논리 번호가 없으므로 zone summary를 본다.
+logical_block_number_t get_block_logical_number(struct hodo_block_pos block_pos){
+    return mapping_info.zone_summary[block_pos.zone_id][block_pos.block_index];
+}
+
+//논리 번호가 지금 놓여 있는 물리 위치
+struct hodo_block_pos hodo_get_block_pos(logical_block_number_t logical_block_number){
+    return mapping_info.mapping_table[logical_block_number - mapping_info.starting_logical_number];
+}
+
+//물리 위치의 장치 상 바이트 주소. hodo의 zone 번호는 seq zone 그룹 안의 번호(/seq/<zone_id>)이다.
+loff_t hodo_get_device_address(struct super_block *sb, struct hodo_block_pos block_pos){
+    struct zonefs_zone *z = &ZONEFS_SB(sb)->s_zgroup[ZONEFS_ZTYPE_SEQ].g_zones[block_pos.zone_id];
+
+    return (z->z_sector << SECTOR_SHIFT) + (loff_t)block_pos.block_index * HODO_DATABLOCK_SIZE;
+}
+
 bool is_directblock(struct hodo_datablock *datablock){
     if(datablock->magic[3] == '0') return true;
     else return false;
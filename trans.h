@@ -12,54 +12,133 @@
 #ifndef __TRANS_H__
 #define __TRANS_H__
 
+struct kstatfs;
+
 /*----------------------------------------------------------------GC용 함수 선언--------------------------------------------------------------------------------*/
 int GC_timing(void);
 int GC(void);
 
 /*-----------------------------------------------------------read_iter용 함수 선언------------------------------------------------------------------------------*/
-void  hodo_read_nth_block(struct hodo_inode *file_inode, int n, struct hodo_datablock *dst_datablock);
+void  hodo_read_nth_block(struct hodo_inode *file_inode, int n, void *dst_block);
 
 /*-------------------------------------------------------------write_iter용 함수 선언----------------------------------------------------------------------------*/
 ssize_t write_one_block(struct kiocb *iocb, struct iov_iter *from);
-ssize_t write_one_block_by_direct_block(struct kiocb *iocb, struct iov_iter *from, logical_block_number_t *out_logical_number, struct hodo_datablock *current_direct_block);
-ssize_t write_one_block_by_indirect_block(struct kiocb *iocb, struct iov_iter *from, logical_block_number_t *out_logical_number, struct hodo_datablock *current_indirect_block);
+ssize_t write_direct_blocks(struct kiocb *iocb, struct iov_iter *from);
+
+/*-------------------------------------------------------------truncate용 함수 선언------------------------------------------------------------------------------*/
+int hodo_truncate_file(struct hodo_inode *file_inode, uint64_t new_size);
+
+/*-------------------------------------------------------------fallocate용 함수 선언-----------------------------------------------------------------------------*/
+int hodo_punch_hole(struct hodo_inode *file_inode, uint64_t offset, uint64_t len);
+int hodo_collapse_range(struct hodo_inode *file_inode, uint64_t offset, uint64_t len);
+int hodo_insert_range(struct hodo_inode *file_inode, uint64_t offset, uint64_t len);
+int hodo_check_preallocation(struct hodo_inode *file_inode, uint64_t offset, uint64_t len);
+
+/*-------------------------------------------------------------reflink용 함수 선언-------------------------------------------------------------------------------*/
+int hodo_clone_range(struct hodo_inode *src, uint32_t src_block, struct hodo_inode *dst, uint32_t dst_block, uint32_t nr_blocks);
+
+/*-------------------------------------------------------------extent용 함수 선언---------------------------------------------------------------------------------*/
+logical_block_number_t hodo_extent_lookup(struct hodo_inode *file_inode, uint32_t file_block, uint32_t *out_len);
+int hodo_extent_insert(struct hodo_inode *file_inode, uint32_t file_block, logical_block_number_t logical_block_number);
+int hodo_extent_insert_range(struct hodo_inode *file_inode, uint32_t file_block, logical_block_number_t logical_block_number, uint32_t len);
+int hodo_extent_truncate(struct hodo_inode *file_inode, uint32_t file_block);
+int hodo_extent_remove_range(struct hodo_inode *file_inode, uint32_t start, uint32_t end);
+int hodo_extent_shift(struct hodo_inode *file_inode, uint32_t from, int64_t delta);
+void hodo_extent_cache_forget(logical_block_number_t leaf_logical_number);
+void hodo_extent_cache_reset(void);
 
 /*-------------------------------------------------------------lookup용 함수 선언-------------------------------------------------------------------------------*/
 uint64_t find_inode_number(struct hodo_inode *dir_hodo_inode, const char *target_name);
 uint64_t find_inode_number_from_direct_block(struct hodo_datablock *direct_block, const char *target_name);
 uint64_t find_inode_number_from_indirect_block(struct hodo_datablock *indirect_block, const char *target_name);
+uint64_t find_inode_number_from_inline_dirent(struct hodo_inode *dir_hodo_inode, const char *target_name);
 
 /*-------------------------------------------------------------readdir용 함수 선언-------------------------------------------------------------------------------*/
 int read_all_dirents(struct hodo_inode *dir_hodo_inode, struct dir_context *ctx, uint64_t *dirent_count);
 int read_all_dirents_from_direct_block(struct hodo_datablock* direct_block,struct dir_context *ctx, uint64_t *dirent_count);
 int read_all_dirents_from_indirect_block(struct hodo_datablock* indirect_block, struct dir_context *ctx, uint64_t *dirent_count);
+int read_all_dirents_from_inline_dirent(struct hodo_inode *dir_hodo_inode, struct dir_context *ctx, uint64_t *dirent_count);
 
 /*-------------------------------------------------------------create용 함수 선언--------------------------------------------------------------------------------*/
 int add_dirent(struct inode* dir, struct hodo_inode* sub_inode);
+int add_dirent_to_inline_dirent(struct hodo_inode *dir_inode, struct hodo_dirent *new_dirent);
 
 /*-------------------------------------------------------------unlink용 함수 선언--------------------------------------------------------------------------------*/
-int remove_dirent(struct hodo_inode *dir_hodo_inode, struct inode *dir, const char *target_name, logical_block_number_t *out_logical_number);
+int remove_dirent(struct hodo_inode *dir_hodo_inode, struct inode *dir, const char *target_name);
 int remove_dirent_from_direct_block(struct hodo_datablock *direct_block, const char *target_name, logical_block_number_t *out_logical_number);
 int remove_dirent_from_indirect_block(struct hodo_datablock *indirect_block, const char *target_name, logical_block_number_t *out_logical_number);
+int remove_dirent_from_inline_dirent(struct hodo_inode *dir_hodo_inode, const char *target_name);
+
+/*-------------------------------------------------------------rename용 함수 선언--------------------------------------------------------------------------------*/
+int replace_dirent(struct hodo_inode *dir_hodo_inode, struct inode *dir, const char *target_name, struct hodo_inode *sub_inode);
+int replace_dirent_in_block(logical_block_number_t logical_block_number, struct hodo_datablock *buf_block, const char *target_name, struct hodo_inode *sub_inode);
+int replace_dirent_in_inline_dirent(struct hodo_inode *dir_hodo_inode, const char *target_name, struct hodo_inode *sub_inode);
+void fill_dirent(struct hodo_dirent *dirent, struct hodo_inode *sub_inode);
 
 /*-------------------------------------------------------------rmdir용 함수 선언--------------------------------------------------------------------------------*/
 bool check_directory_empty(struct dentry *dentry);
 bool check_directory_empty_from_direct_block(struct hodo_datablock *direct_block);
 bool check_directory_empty_from_indirect_block(struct hodo_datablock *indirect_block);
+bool check_directory_empty_from_inline_dirent(struct hodo_inode *dir_hodo_inode);
 
 /*-------------------------------------------------------------비트맵용 함수 선언---------------------------------------------------------------------------------*/
+void hodo_init_logical_allocator(void);
+void hodo_drain_logical_batches(void);
+uint32_t hodo_get_free_logical_count(void);
 int hodo_get_next_logical_number(void);
+int hodo_get_logical_number_near(logical_block_number_t hint);
 int hodo_erase_table_entry(int table_entry_index);
 
+/*-------------------------------------------------------------공유 블록용 함수 선언-----------------------------------------------------------------------------*/
+bool hodo_is_block_shared(logical_block_number_t logical_block_number);
+bool hodo_get_shared_range(logical_block_number_t start, uint32_t len);
+
+/*-------------------------------------------------------------zone 통계용 함수 선언---------------------------------------------------------------------------------*/
+void hodo_rebuild_zone_stats(void);
+int hodo_get_GC_victim(void);
+uint32_t hodo_get_zone_valid_count(int zone_id);
+uint32_t hodo_get_zone_invalid_count(int zone_id);
+uint32_t hodo_get_free_zone_count(void);
+int hodo_fill_statfs(struct kstatfs *buf);
+
+/*-------------------------------------------------------------아이노드 입출력 함수 선언-----------------------------------------------------------------------------*/
+ssize_t hodo_read_inode(logical_block_number_t ino, struct hodo_inode *out_inode);
+ssize_t hodo_write_inode(struct hodo_inode *hodo_inode);
+int hodo_sync_inode(struct inode *inode);
+void hodo_lock_inode(struct inode *inode);
+void hodo_unlock_inode(struct inode *inode);
+void hodo_load_inode_times(struct hodo_inode *hodo_inode, struct inode *inode);
+void hodo_release_inode_slot(logical_block_number_t ino);
+void hodo_evict_inode(logical_block_number_t ino);
+
+/*-------------------------------------------------------------트랜잭션용 함수 선언-------------------------------------------------------------------------------*/
+//hodo_trans_begin에서 hodo_trans_end까지 연산 하나가 들고 있는 트랜잭션 핸들. 호출한 쪽의 스택에 둔다.
+struct hodo_trans_handle {
+    struct task_struct *task;                                       // 트랜잭션을 연 태스크
+    struct list_head list;                                          // hodo_trans의 열린 핸들 목록
+};
+
+void hodo_trans_begin(struct hodo_trans_handle *handle);
+void hodo_trans_end(struct hodo_trans_handle *handle);
+int hodo_trans_commit(void);
+void hodo_trans_discard(void);
+
 /*-------------------------------------------------------------입출력 함수 선언-----------------------------------------------------------------------------------*/
 ssize_t hodo_read_struct(logical_block_number_t logical_block_number, void *out_buf, size_t len);
 ssize_t hodo_write_struct(void *buf, size_t len, logical_block_number_t *logical_block_number);
+ssize_t hodo_write_zone_iter(struct hodo_block_pos block_pos, struct iov_iter *iter);
 ssize_t compact_datablock(struct hodo_datablock *source_block, int remove_start_index, int remove_size, logical_block_number_t *out_logical_number);
 ssize_t hodo_read_on_disk_mapping_info(void);
 
 /*-------------------------------------------------------------도구 함수 선언-------------------------------------------------------------------------------------*/
 bool is_dirent_valid(struct hodo_dirent *dirent);
+bool is_dirent_name_equal(struct hodo_dirent *dirent, const char *target_name);
+bool is_inline_dir(struct hodo_inode *hodo_inode);
 bool is_block_logical_number_valid(logical_block_number_t logical_block_number);
 bool is_directblock(struct hodo_datablock *datablock);
+bool is_packable_inode(struct hodo_inode *hodo_inode);
+logical_block_number_t get_block_logical_number(struct hodo_block_pos block_pos);
+struct hodo_block_pos hodo_get_block_pos(logical_block_number_t logical_block_number);
+loff_t hodo_get_device_address(struct super_block *sb, struct hodo_block_pos block_pos);
 
 #endif
\ No newline at end of file
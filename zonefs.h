@@ -109,6 +109,13 @@ struct zonefs_inode_info {
 
         /* guarded by i_truncate_mutex */
         unsigned int            i_wr_refcnt;
+
+        /*
+         * Serializes read-modify-write cycles of the on-disk hodo inode of
+         * this inode (data writes, truncation, dirent changes, link count
+         * and attribute updates from writeback).
+         */
+        struct mutex            i_hodo_mutex;
 };
 
 static inline struct zonefs_inode_info *ZONEFS_I(struct inode *inode)
@@ -246,6 +253,10 @@ struct zonefs_sb_info {
         bool                    s_sysfs_registered;
         struct kobject          s_kobj;
         struct completion       s_kobj_unregister;
+
+        /* hodo log and GC counters, under the s_kobj directory */
+        struct kobject          s_hodo_kobj;
+        struct completion       s_hodo_kobj_unregister;
 };
 
 static inline struct zonefs_sb_info *ZONEFS_SB(struct super_block *sb)
@@ -282,6 +293,7 @@ extern const struct file_operations hodo_dir_operations;
 
 extern const struct inode_operations hodo_file_inode_operations;
 extern const struct inode_operations hodo_dir_inode_operations;
+extern const struct inode_operations hodo_symlink_inode_operations;
 
 extern const struct address_space_operations hodo_file_aops;
 